@@ -29,7 +29,7 @@ void Main()
 
 		for (const auto& event : bus.events())
 		{
-			Print << U"イベントを受信: " << event.channel << U" value=" << event.value;
+			Print << U"イベントを受信: " << event.channel << U" value=" << event.value();
 		}
 
 		if (SimpleGUI::Button(U"Emit: test1", Vec2{ 20, 50 }))
@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include <string>
+
+#include <Siv3D/Types.hpp>
+#include <Siv3D/String.hpp>
+#include <Siv3D/StringView.hpp>
+#include <Siv3D/FormatData.hpp>
+
+namespace MessageBus
+{
+	/// @brief MessageBus 内でインターンされたチャンネルの情報
+	/// @remark MessageBus が破棄されるまで同じアドレスに存在し続けます
+	/// @remark ただし、購読していないチャンネルをパターン購読で受信した場合はインターンされず、次回の tick() までのみ有効です
+	struct ChannelInfo
+	{
+		/// @brief MessageBus 内で一意な番号（インターンされていないチャンネルは 0xFFFFFFFE）
+		s3d::uint32 index;
+
+		/// @brief チャンネル名
+		s3d::String name;
+
+		/// @brief チャンネル名（UTF-8）
+		std::string utf8Name;
+
+		/// @brief パターン購読（psubscribe）の場合 true
+		bool isPattern = false;
+	};
+
+	/// @brief インターン済みチャンネルへのハンドル
+	/// @remark 比較はポインタ比較のみで行われます。発行元の MessageBus より長く保持しないでください
+	class ChannelId
+	{
+	public:
+		ChannelId() = default;
+
+		explicit ChannelId(const ChannelInfo* info) noexcept
+			: m_info(info) {}
+
+		[[nodiscard]]
+		bool isValid() const noexcept { return m_info != nullptr; }
+
+		[[nodiscard]]
+		explicit operator bool() const noexcept { return isValid(); }
+
+		/// @brief MessageBus 内で一意な番号（無効なハンドルの場合は 0xFFFFFFFF）
+		[[nodiscard]]
+		s3d::uint32 index() const noexcept { return m_info ? m_info->index : 0xFFFFFFFFu; }
+
+		/// @brief チャンネル名（無効なハンドルの場合は空文字列）
+		[[nodiscard]]
+		const s3d::String& name() const noexcept
+		{
+			static const s3d::String empty;
+			return m_info ? m_info->name : empty;
+		}
+
+		/// @brief チャンネル名（UTF-8、無効なハンドルの場合は空文字列）
+		[[nodiscard]]
+		std::string_view utf8Name() const noexcept { return m_info ? std::string_view{ m_info->utf8Name } : std::string_view{}; }
+
+		[[nodiscard]]
+		const ChannelInfo* info() const noexcept { return m_info; }
+
+		[[nodiscard]]
+		friend bool operator==(const ChannelId& lhs, const ChannelId& rhs) noexcept { return lhs.m_info == rhs.m_info; }
+
+		[[nodiscard]]
+		friend bool operator==(const ChannelId& lhs, s3d::StringView rhs) noexcept { return lhs.isValid() && s3d::StringView{ lhs.name() } == rhs; }
+
+	private:
+		const ChannelInfo* m_info = nullptr;
+	};
+
+	// Siv3D Formatter 対応
+	inline void Formatter(s3d::FormatData& formatData, const ChannelId& value)
+	{
+		formatData.string += value.name();
+	}
+}
@@ -1,7 +1,16 @@
 #pragma once
 
 #include "WindowsLibrary.hpp"
+#include "ChannelId.hpp"
+#include "PayloadCodec.hpp"
+#include "Serialization.hpp"
+#include <cstddef>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <span>
+#include <string>
+#include <string_view>
 
 #include <Siv3D/StringView.hpp>
 #include <Siv3D/String.hpp>
@@ -11,6 +20,135 @@
 
 namespace MessageBus
 {
+	/// @brief emit() の配信モード
+	enum class DeliveryMode
+	{
+		/// @brief PUBLISH の応答をバッチごとにログへ出力します
+		Acknowledged,
+
+		/// @brief PUBLISH の応答は件数の集計のみ行い、ログを出力しません（エラーは1秒に1回まとめて出力）
+		FireAndForget,
+	};
+
+	/// @brief 購読したチャンネルの受信モード
+	enum class ReceiveMode
+	{
+		/// @brief 受信した全てのメッセージをイベントにします
+		All,
+
+		/// @brief 1回の tick() につき最新のメッセージのみをイベントにします（古いものは同じ位置で置き換えられ、パースされません）
+		/// @remark カーソル位置やセンサー値など、最新の状態のみが意味を持つチャンネル向けです
+		/// @remark tick(budget, maxEvents) で持ち越されたメッセージも置き換えます（スレッドモードでI/Oスレッドとのキューに残っている分は、受け取った tick() ごとに1件になります）
+		LatestOnly,
+	};
+
+	/// @brief 通信に使うバックエンド
+	enum class Transport
+	{
+		/// @brief Redis サーバーを経由します
+		Redis,
+
+		/// @brief 同じマシン上のプロセス間で、名前付き共有メモリのリングバッファを使います（Redis サーバーは不要です）
+		/// @remark ip / port / password は使われません。cluster と declareStream() は使えず、close() は何もしません
+		SharedMemory,
+	};
+
+	/// @brief チャンネルごとの送信オプション
+	struct EmitOptions
+	{
+		/// @brief true の場合、未送信の emit() を上書きし、フレームごとに最新の値のみを送信します
+		/// @remark スライダーなど、最新の値のみが意味を持つチャンネル向けです
+		bool coalesce = false;
+
+		/// @brief 1秒あたりの最大送信数（0 の場合は無制限）
+		/// @remark coalesce が false の場合、超過した emit() は破棄されます。true の場合は最新の値が次のフレームに持ち越されます
+		double rateLimit = 0.0;
+
+		/// @brief 連続して送信できる最大数（トークンバケットの容量、1 未満は 1 として扱います）
+		double burst = 1.0;
+	};
+
+	/// @brief ストリームチャンネルのオプション
+	struct StreamOptions
+	{
+		/// @brief ストリームに残すおおよその最大エントリ数（XADD の MAXLEN ~ に渡します。0 の場合は削除しません）
+		size_t maxLength = 10000;
+	};
+
+	struct MessageBusOptions
+	{
+		/// @brief 接続先のIPアドレス
+		s3d::StringView ip;
+
+		/// @brief 接続先のポート番号
+		s3d::uint16 port;
+
+		/// @brief 認証パスワード（オプション）
+		s3d::Optional<s3d::StringView> password = s3d::none;
+
+		/// @brief Redis の Unix ドメインソケットのパス（指定した場合は ip / port の代わりに使います）
+		/// @remark 同じマシンで動いている Redis に、TCP のループバックより少ないオーバーヘッドで接続できます（再接続の動作は TCP と同じです）
+		/// @remark クラスタモードのシャードへの接続は、CLUSTER SLOTS が返すアドレスに TCP で行います
+		/// @remark POSIX 環境のみ対応しています。Windows では接続せず、error() がその旨を返します
+		s3d::Optional<s3d::StringView> unixSocket = s3d::none;
+
+		/// @brief true の場合、専用のI/Oスレッドで通信を行います
+		/// @remark tick() は受信済みイベントの受け取りと送信キューの受け渡しのみを行います
+		bool threaded = false;
+
+		/// @brief 送信キューの容量（emit() はキューが満杯の場合 false を返します）
+		size_t outboundQueueCapacity = 4096;
+
+		/// @brief スレッドモードで受信イベントを受け渡すキューの容量
+		size_t inboundQueueCapacity = 4096;
+
+		/// @brief true の場合、1回の tick() で送信する PUBLISH をまとめて書式化し、応答もまとめて処理します
+		/// @remark false の場合はイベントごとにコマンドを組み立てて送信します
+		bool batchedPublish = true;
+
+		/// @brief emit() の配信モード
+		DeliveryMode deliveryMode = DeliveryMode::Acknowledged;
+
+		/// @brief true の場合、hiredis の応答オブジェクトやコマンドバッファをサイズクラス別のプールから確保します
+		/// @remark hiredis の確保関数はプロセス全体で共有されるため、プロセスで最初に作る MessageBus の設定で決まり、以降の全ての MessageBus に適用されます
+		/// @remark false の場合は既定の malloc / free をそのまま使い、allocatorStats() の集計も行いません
+		bool pooledAllocator = false;
+
+		/// @brief true の場合、Redis Cluster に接続します（ip / port はシードノード）
+		/// @remark チャンネルはハッシュスロットを持つシャードで SSUBSCRIBE され、emit() は SPUBLISH でそのシャードに送られます
+		/// @remark パターン購読はシャードに対応していないため、シードノードで PSUBSCRIBE します
+		bool cluster = false;
+
+		/// @brief ストリームチャンネルを1回の XREAD で読み込む、ストリームごとの最大エントリ数
+		size_t streamReadCount = 256;
+
+		/// @brief emit() で送信するペイロードの形式
+		/// @remark 受信側は先頭の識別バイトで形式を判別するため、送信側ごとに異なる形式を使えます
+		PayloadFormat payloadFormat = PayloadFormat::JSON;
+
+		/// @brief true の場合、emit() したイベントを Redis を経由せずに自分の events() に直接渡します
+		/// @remark MessageBusHub に設定した場合は、同じハブに接続している全ての MessageBus に渡します
+		/// @remark Redis から戻ってきた同じイベントは、ペイロードの先頭に付けた送信元タグで判別して破棄します（タグは受信時に取り除かれます）
+		/// @remark 送信するペイロードの先頭に9バイトのタグが付くため、通信上の形式が変わります。同じチャンネルを受信する全ての MessageBus で有効にしてください
+		/// @remark redis-cli や他の言語のクライアントなど、このライブラリ以外の購読者にはタグ付きのバイト列（JSON や MessagePack として読めない）が届きます
+		bool localDelivery = false;
+
+		/// @brief 通信に使うバックエンド
+		Transport transport = Transport::Redis;
+
+		/// @brief Transport::SharedMemory で使う共有メモリの名前（同じ名前を使う MessageBus 同士で通信します）
+		s3d::StringView sharedMemoryName = U"Siv3D_MessageBus";
+
+		/// @brief Transport::SharedMemory のスロット数（2 の累乗に切り上げます。読み込みがこれ以上遅れると古いものから破棄されます）
+		size_t sharedMemorySlotCount = 4096;
+
+		/// @brief Transport::SharedMemory の1スロットの大きさ（チャンネル名とペイロードの合計の上限で、超える emit() は送信されません）
+		/// @remark 同じ名前の共有メモリを使う MessageBus は、スロット数と大きさを揃える必要があります
+		size_t sharedMemorySlotSize = 1024;
+	};
+
+	class MessageBusHub;
+
 	class MessageBus
 	{
 	public:
@@ -20,12 +158,34 @@ namespace MessageBus
 		/// @param password 認証パスワード（オプション）
 		MessageBus(s3d::StringView ip, s3d::uint16 port, s3d::Optional<s3d::StringView> password = s3d::none);
 
+		/// @brief MessageBusを初期化します
+		/// @param options 接続オプション
+		explicit MessageBus(const MessageBusOptions& options);
+
+		/// @brief ハブの接続を共有する MessageBus を初期化します
+		/// @param hub 接続を共有するハブ
+		/// @remark 購読はハブでチャンネルごとに参照カウントされ、受信したメッセージはハブで1回だけ受信してから各 MessageBus に配られます
+		/// @remark 送信オプション・ペイロード形式・配信モードはハブの設定に従います。close() は何もしません
+		explicit MessageBus(MessageBusHub& hub);
+
 		/// @brief MessageBusを終了します
+		/// @remark クラスタモードのシャードやストリームチャンネルの読み込み用を含む、全ての接続を切断します（再接続は行いません）
 		void close();
 
 		/// @brief イベント処理を行います（メインループで毎フレーム呼び出す）
 		void tick();
 
+		/// @brief 処理時間とイベント数に上限を設けてイベント処理を行います
+		/// @param budget 受信処理に使う最大時間（ソケットが空になった時点で終了します）
+		/// @param maxEvents events() に渡す最大イベント数（超えた分は次回以降の tick() に持ち越します）
+		/// @remark スレッドモードでは受信はI/Oスレッドで行われるため、budget はキューからの受け取りにのみ適用されます
+		void tick(s3d::Duration budget, size_t maxEvents = SIZE_MAX);
+
+		/// @brief 受信済みで、まだ events() に渡していないイベントの数を取得します
+		/// @remark スレッドモードではI/Oスレッドとのキューに残っている分を含む概算値です
+		[[nodiscard]]
+		size_t backlog() const;
+
 		/// @brief 接続状態を取得します
 		/// @return 接続済みの場合 true
 		[[nodiscard]]
@@ -36,6 +196,73 @@ namespace MessageBus
 		[[nodiscard]]
 		explicit operator bool() const { return isConnected(); }
 
+		/// @brief PUBLISH の送信・応答の集計値
+		struct PublishStats
+		{
+			/// @brief 送信した PUBLISH の数
+			s3d::uint64 sent = 0;
+
+			/// @brief 応答を受け取った PUBLISH の数
+			s3d::uint64 replied = 0;
+
+			/// @brief 受信したクライアント数の合計
+			s3d::uint64 delivered = 0;
+
+			/// @brief エラー応答の数
+			s3d::uint64 errors = 0;
+
+			/// @brief EmitOptions::coalesce により上書きされ、送信されなかった emit() の数
+			s3d::uint64 coalesced = 0;
+
+			/// @brief EmitOptions::rateLimit により破棄された emit() の数
+			s3d::uint64 rateLimited = 0;
+
+			/// @brief キューに積まれた後、送信する時点で切断していたため破棄された emit() の数
+			/// @remark Transport::SharedMemory では、書き込むスロットが他のプロセスの書き込み中のままだったため破棄された数も含みます
+			s3d::uint64 dropped = 0;
+		};
+
+		/// @brief PUBLISH の集計値を取得します
+		[[nodiscard]]
+		PublishStats publishStats() const;
+
+		/// @brief hiredis の確保の集計値（プロセス全体）
+		struct AllocatorStats
+		{
+			/// @brief hiredis からの確保要求の数
+			s3d::uint64 allocations = 0;
+
+			/// @brief プールの空きブロックで賄えた確保の数
+			s3d::uint64 poolHits = 0;
+
+			/// @brief malloc を呼び出した回数（スラブの確保を含む）
+			s3d::uint64 upstreamAllocations = 0;
+
+			/// @brief hiredis が使用中のバイト数
+			s3d::uint64 bytesInUse = 0;
+
+			/// @brief bytesInUse の最大値
+			s3d::uint64 peakBytesInUse = 0;
+
+			/// @brief malloc から確保しているバイト数（プールの空きブロックを含む）
+			s3d::uint64 reservedBytes = 0;
+
+			/// @brief reservedBytes の最大値
+			s3d::uint64 peakReservedBytes = 0;
+
+			/// @brief プールのヒット率
+			[[nodiscard]]
+			double hitRate() const noexcept
+			{
+				return (allocations == 0) ? 0.0 : static_cast<double>(poolHits) / allocations;
+			}
+		};
+
+		/// @brief hiredis の確保の集計値を取得します
+		/// @remark MessageBusOptions::pooledAllocator でプールを有効にした場合のみ集計され、それ以外では全て 0 です
+		[[nodiscard]]
+		static AllocatorStats allocatorStats();
+
 		/// @brief エラーメッセージを取得します
 		/// @return エラーメッセージ文字列
 		[[nodiscard]]
@@ -47,33 +274,310 @@ namespace MessageBus
 
 		struct Event
 		{
-			s3d::String channel;
-			s3d::JSON value;
+			Event() = default;
+
+			/// @param payload ペイロード（イベントより長く生存する領域を指している必要があります）
+			Event(ChannelId channel, std::string_view payload, ChannelId pattern = ChannelId{})
+				: channel(channel)
+				, pattern(pattern)
+				, m_payload(payload) {}
+
+			/// @brief 受信したチャンネル（名前は channel.name() で取得できます）
+			/// @remark 購読していないチャンネルをパターン購読で受信した場合は、次回の tick() までのみ有効なハンドルです（tick() をまたいで比較する場合は名前を使ってください）
+			ChannelId channel;
+
+			/// @brief パターン購読で受信した場合、一致したパターン（それ以外は無効なハンドル）
+			ChannelId pattern;
+
+			/// @brief 受信したペイロード（JSON の場合は UTF-8 のまま、MessagePack の場合は識別バイトを含むバイト列）
+			/// @remark MessageBus のフレームアリーナ上の領域を指しており、次回の tick() まで有効です
+			[[nodiscard]]
+			std::string_view payload() const noexcept { return m_payload; }
+
+			/// @brief 受信したペイロードのバイト列（変換せずに emitRaw() やログへ渡せます）
+			/// @remark payload() と同じ領域を指しており、次回の tick() まで有効です
+			[[nodiscard]]
+			std::span<const std::byte> rawPayload() const noexcept { return std::as_bytes(std::span{ m_payload }); }
+
+			/// @brief ペイロードが MessagePack の場合 true
+			[[nodiscard]]
+			bool isBinary() const noexcept { return PayloadCodec::IsBinary(m_payload); }
+
+			/// @brief ペイロードを JSON として取得します
+			/// @remark 初回呼び出し時にパースし、結果をキャッシュします（空/失敗時は Invalid）
+			/// @remark MessagePack のペイロードはテキストを経由せずに JSON へ変換します
+			[[nodiscard]]
+			const s3d::JSON& value() const;
+
+			/// @brief ペイロードを MESSAGEBUS_FIELDS を持つ構造体などの型として取得します
+			/// @remark MessagePack のペイロードは s3d::JSON を経由せずに直接読み込みます。JSON テキストの場合は value() の結果から読み込みます
+			/// @return 型が一致しない場合は none
+			template <Serializable Type>
+			[[nodiscard]]
+			s3d::Optional<Type> as() const
+			{
+				return PayloadCodec::DecodeValue<Type>(m_payload, [this]() -> const s3d::JSON& { return value(); });
+			}
+
+		private:
+			std::string_view m_payload;
+			mutable s3d::Optional<s3d::JSON> m_value;
+		};
+
+		/// @brief チャンネルごとのイベントハンドラ
+		using EventHandler = std::function<void(const Event&)>;
+
+		/// @brief 受信順に並べたイベントの位置（チャンネルごとのバッファとその中での位置）
+		struct EventRef
+		{
+			s3d::uint32 bucket;
+			s3d::uint32 index;
+		};
+
+		/// @brief 受信済みイベントの一覧（受信順）
+		/// @remark イベント本体はチャンネルごとのバッファに格納されており、この一覧はそれを受信順に参照します。次回の tick() まで有効です
+		class EventList
+		{
+		public:
+			class Iterator
+			{
+			public:
+				using iterator_category = std::forward_iterator_tag;
+				using value_type = Event;
+				using difference_type = std::ptrdiff_t;
+				using pointer = const Event*;
+				using reference = const Event&;
+
+				Iterator() = default;
+
+				Iterator(const EventList* list, size_t pos) noexcept
+					: m_list(list), m_pos(pos) {}
+
+				reference operator*() const { return (*m_list)[m_pos]; }
+
+				pointer operator->() const { return &(*m_list)[m_pos]; }
+
+				Iterator& operator++() noexcept { ++m_pos; return *this; }
+
+				Iterator operator++(int) noexcept { Iterator tmp = *this; ++m_pos; return tmp; }
+
+				bool operator==(const Iterator& other) const noexcept = default;
+
+			private:
+				const EventList* m_list = nullptr;
+				size_t m_pos = 0;
+			};
+
+			EventList(const s3d::Array<s3d::Array<Event>>& buckets, const s3d::Array<EventRef>& order) noexcept
+				: m_buckets(&buckets), m_order(&order) {}
+
+			[[nodiscard]]
+			size_t size() const noexcept { return m_order->size(); }
+
+			[[nodiscard]]
+			bool isEmpty() const noexcept { return m_order->empty(); }
+
+			[[nodiscard]]
+			bool empty() const noexcept { return m_order->empty(); }
+
+			[[nodiscard]]
+			const Event& operator[](size_t i) const
+			{
+				const EventRef& ref = (*m_order)[i];
+				return (*m_buckets)[ref.bucket][ref.index];
+			}
+
+			[[nodiscard]]
+			Iterator begin() const noexcept { return Iterator{ this, 0 }; }
+
+			[[nodiscard]]
+			Iterator end() const noexcept { return Iterator{ this, size() }; }
+
+		private:
+			const s3d::Array<s3d::Array<Event>>* m_buckets;
+			const s3d::Array<EventRef>* m_order;
 		};
 
 		/// @brief チャンネルを購読します
-		bool subscribe(s3d::StringView channel);
+		/// @remark 任意のスレッドから呼び出せます
+		/// @return チャンネルのハンドル（失敗した場合は無効なハンドル）
+		ChannelId subscribe(s3d::StringView channel);
+
+		/// @brief チャンネルを購読し、イベントハンドラを登録します
+		/// @remark ハンドラは tick() の中で、そのチャンネルのイベントに対してのみ呼び出されます
+		/// @remark 同じチャンネルに複数のハンドラを登録できます。unsubscribe() で全て解除されます
+		/// @return チャンネルのハンドル（失敗した場合は無効なハンドル）
+		ChannelId subscribe(s3d::StringView channel, EventHandler handler);
+
+		/// @brief 受信モードを指定してチャンネルを購読します
+		/// @remark 受信モードは unsubscribe() で ReceiveMode::All に戻ります
+		/// @return チャンネルのハンドル（失敗した場合は無効なハンドル）
+		ChannelId subscribe(s3d::StringView channel, ReceiveMode mode);
+
+		/// @brief 受信モードを指定してチャンネルを購読し、イベントハンドラを登録します
+		/// @return チャンネルのハンドル（失敗した場合は無効なハンドル）
+		ChannelId subscribe(s3d::StringView channel, ReceiveMode mode, EventHandler handler);
+
+		/// @brief チャンネルを購読し、型付きのイベントハンドラを登録します
+		/// @remark ペイロードを Type として読み込めなかったイベントではハンドラは呼ばれません
+		/// @return チャンネルのハンドル（失敗した場合は無効なハンドル）
+		template <Serializable Type, class Handler>
+			requires std::invocable<Handler&, const Type&>
+		ChannelId subscribe(s3d::StringView channel, Handler handler)
+		{
+			return subscribe(channel, EventHandler{ [handler = std::move(handler)](const Event& event) mutable
+				{
+					if (const auto value = event.as<Type>())
+					{
+						handler(*value);
+					}
+				} });
+		}
+
+		/// @brief パターンに一致する全てのチャンネルを購読します
+		/// @remark パターンは '/' 区切りで、"*" は任意の1階層、末尾の "**" は残りの1階層以上に一致します（例: U"game/*/score", U"game/**"）
+		/// @remark 受信したイベントの channel は実際のチャンネル、pattern はこのパターンになり、events(pattern) で取得できます
+		/// @return パターンのハンドル（パターンが不正な場合は無効なハンドル）
+		ChannelId psubscribe(s3d::StringView pattern);
+
+		/// @brief パターンに一致する全てのチャンネルを購読し、イベントハンドラを登録します
+		/// @return パターンのハンドル（パターンが不正な場合は無効なハンドル）
+		ChannelId psubscribe(s3d::StringView pattern, EventHandler handler);
+
+		/// @brief パターン購読を解除します
+		bool punsubscribe(s3d::StringView pattern);
 
 		/// @brief チャンネルの購読を解除します
 		bool unsubscribe(s3d::StringView channel);
 
+		/// @brief チャンネル（またはパターン）の購読を解除します
+		bool unsubscribe(ChannelId channel);
+
+		/// @brief インターン済みのチャンネルを検索します
+		/// @remark 同名のチャンネルが無い場合はパターンを検索します
+		/// @return チャンネルのハンドル（一度も購読されていない場合は無効なハンドル）
+		[[nodiscard]]
+		ChannelId findChannel(s3d::StringView channel) const;
+
 		/// @brief イベントを送信します
+		/// @remark 任意のスレッドから呼び出せます。送信は次回の tick()（スレッドモードではI/Oスレッド）で行われます
+		/// @remark それまでに切断した場合、キューに積まれたイベントは送信されずに破棄され、publishStats().dropped に数えられます
 		/// @param channel 送信先チャンネル名
 		/// @param payload イベントに含めるJSON
+		/// @return 送信キューに積めた場合 true（切断中やキューが満杯の場合は false）
+		bool emit(s3d::StringView channel, const s3d::Optional<s3d::JSON>& payload = s3d::none);
+
+		/// @brief MESSAGEBUS_FIELDS を持つ構造体などの値をイベントとして送信します
+		/// @remark 値は s3d::JSON を経由せずに MessageBusOptions::payloadFormat の形式へ直接書き込まれます
+		/// @param channel 送信先チャンネル名
+		/// @param value イベントに含める値
+		/// @return イベント送信が成功した場合 true
+		template <Serializable Type>
+			requires (not std::same_as<Type, s3d::JSON>)
+		bool emit(s3d::StringView channel, const Type& value)
+		{
+			std::string payload;
+			PayloadCodec::EncodeValue(value, payloadFormat(), payload);
+			return emitPayload(channel, std::move(payload));
+		}
+
+		/// @brief 書式化済みのペイロードをそのまま送信します
+		/// @remark チャンネル名の変換やペイロードの書式化を行わないため、Event::rawPayload() を別の MessageBus へ転送する場合などに使います
+		/// @remark 受信側は先頭の識別バイトで形式を判別するため、JSON テキストまたは emit() が送るものと同じ形式で渡してください
+		/// @param channel 送信先チャンネル（他の MessageBus が発行したハンドルも使えます）
+		/// @param payload ペイロード（呼び出し中のみ参照します）
+		/// @return イベント送信が成功した場合 true
+		bool emitRaw(ChannelId channel, std::span<const std::byte> payload);
+
+		/// @brief 書式化済みのペイロードをそのまま送信します
+		/// @param u8channel 送信先チャンネル名（UTF-8）
+		/// @param payload ペイロード（呼び出し中のみ参照します）
 		/// @return イベント送信が成功した場合 true
-		bool emit(s3d::StringView channel, s3d::Optional<s3d::JSON> payload = s3d::none);
+		bool emitRaw(std::string_view u8channel, std::span<const std::byte> payload);
+
+		/// @brief emit() で送信するペイロードの形式
+		[[nodiscard]]
+		PayloadFormat payloadFormat() const noexcept;
+
+		/// @brief チャンネルの送信オプションを設定します
+		/// @remark 任意のスレッドから呼び出せます。次回の送信処理から適用されます
+		/// @param channel 対象のチャンネル名
+		/// @param options 送信オプション（既定値を渡すと通常の送信に戻ります）
+		void setEmitOptions(s3d::StringView channel, const EmitOptions& options);
+
+		/// @brief チャンネルをストリームチャンネルとして宣言します
+		/// @remark 任意のスレッドから呼び出せます。以降の emit() は XADD でストリームに追記され、subscribe() したストリームは専用の接続から XREAD でまとめて読み込まれます
+		/// @remark 読み込んだ位置を保持しているため、再接続までの間に追加されたエントリも取りこぼしません（maxLength を超えて削除された分を除く）
+		/// @remark パターン購読では受信できません。また、クラスタモードでは使用できません
+		/// @param channel 対象のチャンネル名（ストリームのキー名になります）
+		/// @param options ストリームのオプション
+		/// @return チャンネルのハンドル（失敗した場合は無効なハンドル）
+		ChannelId declareStream(s3d::StringView channel, const StreamOptions& options = {});
 
-		/// @brief 受信済みイベント
+		/// @brief 受信済みイベント（受信順）
 		[[nodiscard]]
-		const s3d::Array<Event>& events() const;
+		EventList events() const;
+
+		/// @brief 指定したチャンネルの受信済みイベント
+		/// @remark 受信時にチャンネルごとに振り分けているため、絞り込みのコストはかかりません
+		/// @return 連続した領域のイベント列（次回の tick() まで有効）
+		[[nodiscard]]
+		std::span<const Event> events(ChannelId channel) const;
+
+		/// @brief 指定したチャンネルの受信済みイベント
+		/// @remark チャンネル名の検索が必要なため、毎フレーム呼ぶ場合は ChannelId を渡す方が高速です
+		[[nodiscard]]
+		std::span<const Event> events(s3d::StringView channel) const;
 
 	private:
 
+		bool emitPayload(s3d::StringView channel, std::string&& payload);
+
 		struct Impl;
 
 		std::unique_ptr<Impl> m_impl;
 
+		friend class MessageBusHub;
+
 	public:
 		~MessageBus();
 	};
+
+	/// @brief 複数の MessageBus で1本の Redis 接続を共有するハブ
+	/// @remark ハブは常に専用のI/Oスレッドで通信します（MessageBusOptions::threaded は無視されます）
+	/// @remark 接続している MessageBus が残っている間は、ハブを破棄しても接続は維持されます
+	class MessageBusHub
+	{
+	public:
+		/// @brief ハブを初期化します
+		/// @param ip 接続先のIPアドレス
+		/// @param port 接続先のポート番号
+		/// @param password 認証パスワード（オプション）
+		MessageBusHub(s3d::StringView ip, s3d::uint16 port, s3d::Optional<s3d::StringView> password = s3d::none);
+
+		/// @brief ハブを初期化します
+		/// @param options 接続オプション
+		explicit MessageBusHub(const MessageBusOptions& options);
+
+		MessageBusHub(const MessageBusHub&) = delete;
+
+		MessageBusHub& operator=(const MessageBusHub&) = delete;
+
+		~MessageBusHub();
+
+		/// @brief 接続状態を取得します
+		/// @return 接続済みの場合 true
+		[[nodiscard]]
+		bool isConnected() const;
+
+		/// @brief 接続している MessageBus の数を取得します
+		[[nodiscard]]
+		size_t frontEndCount() const;
+
+	private:
+
+		friend class MessageBus;
+
+		std::shared_ptr<MessageBus::Impl> m_impl;
+	};
 }
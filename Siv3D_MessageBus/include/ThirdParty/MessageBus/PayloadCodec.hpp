@@ -0,0 +1,205 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Siv3D/Types.hpp>
+#include <Siv3D/JSON.hpp>
+
+namespace MessageBus
+{
+	/// @brief emit() で送信するペイロードの形式
+	enum class PayloadFormat
+	{
+		/// @brief JSON テキスト（UTF-8）
+		JSON,
+
+		/// @brief 識別バイトに続く MessagePack
+		/// @remark 数値の多いデータを、テキスト化と UTF-32 変換を経ずに小さく送れます
+		MessagePack,
+	};
+
+	/// @brief MessagePack のペイロードの先頭に付ける識別バイト
+	/// @remark 0xC1 は MessagePack で使われず、UTF-8 の JSON テキストの先頭にも現れないため、JSON のみを扱うクライアントとも共存できます
+	inline constexpr unsigned char BINARY_PAYLOAD_MARKER = 0xC1;
+
+	/// @brief 送信元タグの先頭に付ける識別バイト（MessageBusOptions::localDelivery で付けます）
+	/// @remark 識別バイトに続く8バイト（ビッグエンディアン）が送信元の番号で、その後ろに元のペイロードが続きます
+	inline constexpr unsigned char ORIGIN_TAG_MARKER = 0xC0;
+
+	/// @brief 送信元タグの長さ（識別バイトを含む）
+	inline constexpr size_t ORIGIN_TAG_SIZE = 9;
+
+	/// @brief MessagePack の書き込み（値に応じて最も短い表現を選びます）
+	class MessagePackWriter
+	{
+	public:
+
+		explicit MessagePackWriter(std::string& out) noexcept
+			: m_out(out) {}
+
+		void writeNil();
+
+		void writeBool(bool value);
+
+		void writeInt(s3d::int64 value);
+
+		void writeUInt(s3d::uint64 value);
+
+		/// @brief float32 で誤差なく表せる場合は float32 で書き込みます
+		void writeDouble(double value);
+
+		void writeString(std::string_view value);
+
+		/// @brief 配列の要素数を書き込みます（続けて要素を書き込みます）
+		void writeArrayHeader(size_t size);
+
+		/// @brief マップの要素数を書き込みます（続けてキーと値を交互に書き込みます）
+		void writeMapHeader(size_t size);
+
+	private:
+
+		std::string& m_out;
+	};
+
+	/// @brief MessagePack の読み込み（ヘッダを1つずつ取り出します）
+	class MessagePackReader
+	{
+	public:
+
+		enum class Type
+		{
+			Nil,
+			Bool,
+			Int,
+			UInt,
+			Float,
+			String,
+			Array,
+			Map,
+		};
+
+		/// @brief 読み込んだ値。Array / Map は要素数のみで、要素は続けて読み込みます
+		struct Token
+		{
+			Type type = Type::Nil;
+
+			bool boolean = false;
+
+			/// @brief Int の値（int64 に収まらない正の整数は UInt）
+			s3d::int64 integer = 0;
+
+			s3d::uint64 unsignedInteger = 0;
+
+			double floating = 0.0;
+
+			/// @brief String の値（読み込み元のバッファを指します）
+			std::string_view string;
+
+			/// @brief Array / Map の要素数
+			size_t size = 0;
+		};
+
+		explicit MessagePackReader(std::string_view data) noexcept
+			: m_data(data) {}
+
+		/// @brief 次の値のヘッダを読み込みます
+		/// @return 末尾に達した、不正な、または未対応（bin / ext）の値の場合 false
+		[[nodiscard]]
+		bool next(Token& token);
+
+		/// @brief 次の値を要素ごと読み飛ばします
+		[[nodiscard]]
+		bool skip();
+
+		/// @brief 全て読み込んだ場合 true
+		[[nodiscard]]
+		bool atEnd() const noexcept { return m_pos == m_data.size(); }
+
+		/// @brief 残りのバイト数
+		[[nodiscard]]
+		size_t remaining() const noexcept { return m_data.size() - m_pos; }
+
+	private:
+
+		std::string_view m_data;
+
+		size_t m_pos = 0;
+
+		bool skip(size_t depth);
+	};
+
+	/// @brief JSON テキストまたは MessagePack へ直接書き込む（s3d::JSON を経由しません）
+	/// @remark beginObject() / beginArray() には要素数を渡し、その数だけ書き込んでから end を呼びます
+	class PayloadWriter
+	{
+	public:
+
+		PayloadWriter(std::string& out, PayloadFormat format);
+
+		void beginObject(size_t size);
+
+		/// @brief オブジェクトのキーを書き込みます（続けて値を1つ書き込みます）
+		void key(std::string_view name);
+
+		void endObject();
+
+		void beginArray(size_t size);
+
+		void endArray();
+
+		void writeNil();
+
+		void writeBool(bool value);
+
+		void writeInt(s3d::int64 value);
+
+		void writeUInt(s3d::uint64 value);
+
+		/// @remark JSON では有限でない値は null になります
+		void writeDouble(double value);
+
+		void writeString(std::string_view value);
+
+		/// @brief s3d::JSON の値をそのまま書き込みます
+		void writeJSON(const s3d::JSON& value);
+
+		[[nodiscard]]
+		PayloadFormat format() const noexcept { return m_format; }
+
+	private:
+
+		std::string& m_out;
+
+		PayloadFormat m_format;
+
+		MessagePackWriter m_msgpack;
+
+		// JSON の区切り文字の管理（階層ごとに最初の要素か）
+		std::vector<bool> m_first;
+
+		bool m_afterKey = false;
+
+		void beginValue();
+	};
+
+	namespace PayloadCodec
+	{
+		/// @brief JSON を指定した形式のペイロードに変換し、out の末尾に追加します
+		void Encode(const s3d::JSON& value, PayloadFormat format, std::string& out);
+
+		/// @brief JSON を指定した形式のペイロードに変換します
+		[[nodiscard]]
+		std::string Encode(const s3d::JSON& value, PayloadFormat format);
+
+		/// @brief ペイロードが MessagePack かを返します
+		[[nodiscard]]
+		bool IsBinary(std::string_view payload) noexcept;
+
+		/// @brief ペイロードを JSON に変換します（先頭の識別バイトで形式を判別します）
+		/// @return 空または不正なペイロードの場合は JSON::Invalid()
+		[[nodiscard]]
+		s3d::JSON Decode(std::string_view payload);
+	}
+}
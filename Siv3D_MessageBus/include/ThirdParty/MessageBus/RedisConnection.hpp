@@ -6,6 +6,7 @@ extern "C" {
 
 #include "RedisConnectionState.hpp"
 #include <functional>
+#include <string_view>
 
 #include <Siv3D/StringView.hpp>
 #include <Siv3D/String.hpp>
@@ -22,11 +23,18 @@ namespace MessageBus
 		s3d::StringView ip;
 		s3d::uint16 port;
 		s3d::Optional<s3d::StringView> password = s3d::none;
+		/// @brief Unix ドメインソケットのパス（指定した場合は ip / port の代わりに使います）
+		/// @remark POSIX 環境のみ対応しています。Windows では接続せずに Failed になります
+		s3d::Optional<s3d::StringView> unixSocket = s3d::none;
 		s3d::Duration heartbeatInterval = s3d::Seconds{ 10 };
+		/// @brief true の場合、hiredis の小さな確保をプールから行います（プロセス全体に適用。プロセスで最初の接続の設定で決まります）
+		bool pooledAllocator = false;
 		std::function<void(redisAsyncContext*)> onConnect;
 		std::function<void(redisAsyncContext*)> onReady;
 		std::function<void()> onDisconnect;
 		std::function<void(redisAsyncContext*, redisReply*)> onPush;
+		/// @brief 購読メッセージの受信（リーダーから直接呼ばれ、引数は呼び出し中のみ有効。pattern は pmessage の場合のみ）
+		std::function<void(std::string_view pattern, std::string_view channel, std::string_view payload)> onMessage;
 	};
 
 	class RedisConnection
@@ -40,12 +48,20 @@ namespace MessageBus
 		const s3d::String& ip() const noexcept { return m_ip; }
 		s3d::uint16 port() const noexcept { return m_port; }
 		s3d::Optional<s3d::String> password() const noexcept { return m_password; }
+		const s3d::Optional<s3d::String>& unixSocket() const noexcept { return m_unixSocket; }
 		RedisConnectionState state() const noexcept { return m_state; }
 		const s3d::String& error() const noexcept { return m_error; }
 		bool isReconnecting() const noexcept { return m_isReconnecting; }
 		redisAsyncContext* context() const noexcept { return m_context; }
 
-		void tick();
+		/// @brief 送受信処理を行います
+		/// @param pollTimeout ソケットが読み書き可能になるまで待機する最大時間
+		void tick(s3d::Duration pollTimeout = s3d::Duration{ 0 });
+
+		/// @brief ソケットを1回だけポーリングし、読み書きを行います（再接続・ハートビートは行いません）
+		/// @param pollTimeout ソケットが読み書き可能になるまで待機する最大時間
+		/// @return 受信データを処理した場合 true
+		bool poll(s3d::Duration pollTimeout = s3d::Duration{ 0 });
 		void disconnect();
 
 	private:
@@ -55,6 +71,7 @@ namespace MessageBus
 		s3d::String m_ip;
 		s3d::uint16 m_port;
 		s3d::Optional<s3d::String> m_password;
+		s3d::Optional<s3d::String> m_unixSocket;
 		s3d::Duration m_heartbeatInterval;
 
 		// 接続状態
@@ -64,6 +81,9 @@ namespace MessageBus
 		int m_reconnectAttempts = 0;
 		bool m_isReconnecting = false;
 
+		// ホスト名の解決待ち（解決が終わるまで tick() から tryConnect() を呼び直す）
+		bool m_resolving = false;
+
 		// ハートビート監視
 		s3d::Stopwatch m_heartbeatTimer;
 
@@ -72,6 +92,7 @@ namespace MessageBus
 		std::function<void(redisAsyncContext*)> m_onReady;
 		std::function<void()> m_onDisconnect;
 		std::function<void(redisAsyncContext*, redisReply*)> m_onPush;
+		std::function<void(std::string_view, std::string_view, std::string_view)> m_onMessage;
 
 	private:
 
@@ -0,0 +1,512 @@
+﻿#pragma once
+
+#include "PayloadCodec.hpp"
+#include <concepts>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <Siv3D/Types.hpp>
+#include <Siv3D/String.hpp>
+#include <Siv3D/StringView.hpp>
+#include <Siv3D/Optional.hpp>
+#include <Siv3D/Array.hpp>
+#include <Siv3D/JSON.hpp>
+#include <Siv3D/Unicode.hpp>
+
+// ================================
+// MESSAGEBUS_FIELDS
+// ================================
+
+#define MESSAGEBUS_DETAIL_EXPAND(x) x
+#define MESSAGEBUS_DETAIL_FE_1(m, x) m(x)
+#define MESSAGEBUS_DETAIL_FE_2(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_1(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_3(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_2(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_4(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_3(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_5(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_4(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_6(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_5(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_7(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_6(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_8(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_7(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_9(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_8(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_10(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_9(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_11(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_10(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_12(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_11(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_13(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_12(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_14(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_13(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_15(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_14(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_16(m, x, ...) m(x) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_15(m, __VA_ARGS__))
+#define MESSAGEBUS_DETAIL_FE_SELECT(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, NAME, ...) NAME
+#define MESSAGEBUS_DETAIL_FOR_EACH(m, ...) MESSAGEBUS_DETAIL_EXPAND(MESSAGEBUS_DETAIL_FE_SELECT(__VA_ARGS__, \
+	MESSAGEBUS_DETAIL_FE_16, MESSAGEBUS_DETAIL_FE_15, MESSAGEBUS_DETAIL_FE_14, MESSAGEBUS_DETAIL_FE_13, \
+	MESSAGEBUS_DETAIL_FE_12, MESSAGEBUS_DETAIL_FE_11, MESSAGEBUS_DETAIL_FE_10, MESSAGEBUS_DETAIL_FE_9, \
+	MESSAGEBUS_DETAIL_FE_8, MESSAGEBUS_DETAIL_FE_7, MESSAGEBUS_DETAIL_FE_6, MESSAGEBUS_DETAIL_FE_5, \
+	MESSAGEBUS_DETAIL_FE_4, MESSAGEBUS_DETAIL_FE_3, MESSAGEBUS_DETAIL_FE_2, MESSAGEBUS_DETAIL_FE_1)(m, __VA_ARGS__))
+
+#define MESSAGEBUS_DETAIL_FIELD_NAME(name) #name,
+#define MESSAGEBUS_DETAIL_VISIT_FIELD(name) visitor(::MessageBus::FieldName{ #name, U"" #name }, self.name);
+
+/// @brief 構造体のメンバーを MessageBus のペイロードとして送受信できるようにします（最大16個）
+/// @remark 構造体の定義内に書きます。メンバー名がそのままキーになります
+/// @code
+/// struct Telemetry
+/// {
+/// 	int32 id;
+/// 	double x;
+/// 	double y;
+///
+/// 	MESSAGEBUS_FIELDS(id, x, y)
+/// };
+/// @endcode
+#define MESSAGEBUS_FIELDS(...) \
+	static constexpr const char* MessageBusFieldNames[] = { MESSAGEBUS_DETAIL_FOR_EACH(MESSAGEBUS_DETAIL_FIELD_NAME, __VA_ARGS__) }; \
+	template <class Self, class Visitor> \
+	static void MessageBusVisitFields(Self& self, Visitor&& visitor) \
+	{ \
+		MESSAGEBUS_DETAIL_FOR_EACH(MESSAGEBUS_DETAIL_VISIT_FIELD, __VA_ARGS__) \
+	}
+
+namespace MessageBus
+{
+	/// @brief MESSAGEBUS_FIELDS で宣言したメンバーの名前
+	struct FieldName
+	{
+		/// @brief ペイロードのキー（UTF-8）
+		std::string_view utf8;
+
+		/// @brief s3d::JSON のキー
+		s3d::StringView name;
+	};
+
+	/// @brief 型とペイロードの変換（Write / Read(MessagePackReader&) / Read(const JSON&) を持つ特殊化で対応する型を増やせます）
+	template <class Type>
+	struct PayloadTraits;
+
+	/// @brief ペイロードとして送受信できる型
+	template <class Type>
+	concept Serializable = requires (PayloadWriter& writer, MessagePackReader& reader, const s3d::JSON& json, const Type& in, Type& out)
+	{
+		PayloadTraits<Type>::Write(writer, in);
+		{ PayloadTraits<Type>::Read(reader, out) } -> std::same_as<bool>;
+		{ PayloadTraits<Type>::Read(json, out) } -> std::same_as<bool>;
+	};
+
+	/// @brief MESSAGEBUS_FIELDS を持つ型
+	template <class Type>
+	concept Reflectable = requires
+	{
+		Type::MessageBusFieldNames;
+	};
+
+	template <>
+	struct PayloadTraits<bool>
+	{
+		static void Write(PayloadWriter& writer, bool value) { writer.writeBool(value); }
+
+		static bool Read(MessagePackReader& reader, bool& out)
+		{
+			MessagePackReader::Token token;
+			if (not reader.next(token) || token.type != MessagePackReader::Type::Bool)
+			{
+				return false;
+			}
+			out = token.boolean;
+			return true;
+		}
+
+		static bool Read(const s3d::JSON& json, bool& out)
+		{
+			if (not json.isBool())
+			{
+				return false;
+			}
+			out = json.get<bool>();
+			return true;
+		}
+	};
+
+	template <class Type>
+		requires (std::is_integral_v<Type> && not std::is_same_v<Type, bool>)
+	struct PayloadTraits<Type>
+	{
+		static void Write(PayloadWriter& writer, Type value)
+		{
+			if constexpr (std::is_signed_v<Type>)
+			{
+				writer.writeInt(value);
+			}
+			else
+			{
+				writer.writeUInt(value);
+			}
+		}
+
+		static bool Read(MessagePackReader& reader, Type& out)
+		{
+			MessagePackReader::Token token;
+			if (not reader.next(token))
+			{
+				return false;
+			}
+
+			// 範囲外の値は失敗にする
+			if (token.type == MessagePackReader::Type::Int)
+			{
+				if (not std::in_range<Type>(token.integer))
+				{
+					return false;
+				}
+				out = static_cast<Type>(token.integer);
+				return true;
+			}
+			if (token.type == MessagePackReader::Type::UInt)
+			{
+				if (not std::in_range<Type>(token.unsignedInteger))
+				{
+					return false;
+				}
+				out = static_cast<Type>(token.unsignedInteger);
+				return true;
+			}
+			return false;
+		}
+
+		static bool Read(const s3d::JSON& json, Type& out)
+		{
+			if (not json.isInteger())
+			{
+				return false;
+			}
+			out = json.get<Type>();
+			return true;
+		}
+	};
+
+	template <class Type>
+		requires std::is_floating_point_v<Type>
+	struct PayloadTraits<Type>
+	{
+		static void Write(PayloadWriter& writer, Type value) { writer.writeDouble(value); }
+
+		static bool Read(MessagePackReader& reader, Type& out)
+		{
+			MessagePackReader::Token token;
+			if (not reader.next(token))
+			{
+				return false;
+			}
+
+			// 整数で送られた値も受け付ける
+			switch (token.type)
+			{
+			case MessagePackReader::Type::Float:
+				out = static_cast<Type>(token.floating);
+				return true;
+			case MessagePackReader::Type::Int:
+				out = static_cast<Type>(token.integer);
+				return true;
+			case MessagePackReader::Type::UInt:
+				out = static_cast<Type>(token.unsignedInteger);
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		static bool Read(const s3d::JSON& json, Type& out)
+		{
+			if (not json.isNumber())
+			{
+				return false;
+			}
+			out = json.get<Type>();
+			return true;
+		}
+	};
+
+	template <>
+	struct PayloadTraits<std::string>
+	{
+		static void Write(PayloadWriter& writer, const std::string& value) { writer.writeString(value); }
+
+		static bool Read(MessagePackReader& reader, std::string& out)
+		{
+			MessagePackReader::Token token;
+			if (not reader.next(token) || token.type != MessagePackReader::Type::String)
+			{
+				return false;
+			}
+			out.assign(token.string);
+			return true;
+		}
+
+		static bool Read(const s3d::JSON& json, std::string& out)
+		{
+			if (not json.isString())
+			{
+				return false;
+			}
+			out = s3d::Unicode::ToUTF8(json.getString());
+			return true;
+		}
+	};
+
+	template <>
+	struct PayloadTraits<s3d::String>
+	{
+		static void Write(PayloadWriter& writer, const s3d::String& value) { writer.writeString(s3d::Unicode::ToUTF8(value)); }
+
+		static bool Read(MessagePackReader& reader, s3d::String& out)
+		{
+			MessagePackReader::Token token;
+			if (not reader.next(token) || token.type != MessagePackReader::Type::String)
+			{
+				return false;
+			}
+			out = s3d::Unicode::FromUTF8(token.string);
+			return true;
+		}
+
+		static bool Read(const s3d::JSON& json, s3d::String& out)
+		{
+			if (not json.isString())
+			{
+				return false;
+			}
+			out = json.getString();
+			return true;
+		}
+	};
+
+	template <Serializable Element>
+	struct PayloadTraits<s3d::Array<Element>>
+	{
+		static void Write(PayloadWriter& writer, const s3d::Array<Element>& value)
+		{
+			writer.beginArray(value.size());
+			for (const auto& element : value)
+			{
+				PayloadTraits<Element>::Write(writer, element);
+			}
+			writer.endArray();
+		}
+
+		static bool Read(MessagePackReader& reader, s3d::Array<Element>& out)
+		{
+			MessagePackReader::Token token;
+			if (not reader.next(token) || token.type != MessagePackReader::Type::Array)
+			{
+				return false;
+			}
+
+			out.resize(token.size);
+			for (auto& element : out)
+			{
+				if (not PayloadTraits<Element>::Read(reader, element))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		static bool Read(const s3d::JSON& json, s3d::Array<Element>& out)
+		{
+			if (not json.isArray())
+			{
+				return false;
+			}
+
+			out.clear();
+			for (const auto& element : json.arrayView())
+			{
+				if (not PayloadTraits<Element>::Read(element, out.emplace_back()))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+
+	/// @brief none は null として送受信します
+	template <Serializable Element>
+	struct PayloadTraits<s3d::Optional<Element>>
+	{
+		static void Write(PayloadWriter& writer, const s3d::Optional<Element>& value)
+		{
+			if (value)
+			{
+				PayloadTraits<Element>::Write(writer, *value);
+			}
+			else
+			{
+				writer.writeNil();
+			}
+		}
+
+		static bool Read(MessagePackReader& reader, s3d::Optional<Element>& out)
+		{
+			// null かどうかは読んでみないと分からないため、ヘッダだけ先読みする
+			MessagePackReader lookahead = reader;
+			MessagePackReader::Token token;
+			if (not lookahead.next(token))
+			{
+				return false;
+			}
+			if (token.type == MessagePackReader::Type::Nil)
+			{
+				reader = lookahead;
+				out.reset();
+				return true;
+			}
+
+			Element value{};
+			if (not PayloadTraits<Element>::Read(reader, value))
+			{
+				return false;
+			}
+			out = std::move(value);
+			return true;
+		}
+
+		static bool Read(const s3d::JSON& json, s3d::Optional<Element>& out)
+		{
+			if (json.isNull())
+			{
+				out.reset();
+				return true;
+			}
+
+			Element value{};
+			if (not PayloadTraits<Element>::Read(json, value))
+			{
+				return false;
+			}
+			out = std::move(value);
+			return true;
+		}
+	};
+
+	/// @brief 形の決まっていない部分は s3d::JSON のまま送受信します
+	template <>
+	struct PayloadTraits<s3d::JSON>
+	{
+		static void Write(PayloadWriter& writer, const s3d::JSON& value) { writer.writeJSON(value); }
+
+		static bool Read(MessagePackReader& reader, s3d::JSON& out);
+
+		static bool Read(const s3d::JSON& json, s3d::JSON& out)
+		{
+			out = json;
+			return true;
+		}
+	};
+
+	/// @brief MESSAGEBUS_FIELDS を持つ構造体はオブジェクトとして送受信します
+	/// @remark 受信時、ペイロードに無いメンバーは元の値のまま、構造体に無いキーは無視します
+	template <Reflectable Type>
+	struct PayloadTraits<Type>
+	{
+		static void Write(PayloadWriter& writer, const Type& value)
+		{
+			writer.beginObject(std::size(Type::MessageBusFieldNames));
+			Type::MessageBusVisitFields(value, [&](FieldName name, const auto& field)
+				{
+					writer.key(name.utf8);
+					PayloadTraits<std::remove_cvref_t<decltype(field)>>::Write(writer, field);
+				});
+			writer.endObject();
+		}
+
+		static bool Read(MessagePackReader& reader, Type& out)
+		{
+			MessagePackReader::Token token;
+			if (not reader.next(token) || token.type != MessagePackReader::Type::Map)
+			{
+				return false;
+			}
+
+			for (size_t i = 0; i < token.size; ++i)
+			{
+				MessagePackReader::Token key;
+				if (not reader.next(key) || key.type != MessagePackReader::Type::String)
+				{
+					return false;
+				}
+
+				bool matched = false;
+				bool succeeded = true;
+				Type::MessageBusVisitFields(out, [&](FieldName name, auto& field)
+					{
+						if (not matched && name.utf8 == key.string)
+						{
+							matched = true;
+							succeeded = PayloadTraits<std::remove_cvref_t<decltype(field)>>::Read(reader, field);
+						}
+					});
+
+				if (not (matched ? succeeded : reader.skip()))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		static bool Read(const s3d::JSON& json, Type& out)
+		{
+			if (not json.isObject())
+			{
+				return false;
+			}
+
+			bool succeeded = true;
+			Type::MessageBusVisitFields(out, [&](FieldName name, auto& field)
+				{
+					if (succeeded && json.hasElement(name.name))
+					{
+						succeeded = PayloadTraits<std::remove_cvref_t<decltype(field)>>::Read(json[name.name], field);
+					}
+				});
+			return succeeded;
+		}
+	};
+
+	namespace PayloadCodec
+	{
+		/// @brief 値を指定した形式のペイロードに変換し、out の末尾に追加します（s3d::JSON を経由しません）
+		template <Serializable Type>
+		void EncodeValue(const Type& value, PayloadFormat format, std::string& out)
+		{
+			PayloadWriter writer{ out, format };
+			PayloadTraits<Type>::Write(writer, value);
+		}
+
+		/// @brief ペイロードを値に変換します
+		/// @param json JSON テキストの場合に使うパース済みの値（MessagePack の場合は使いません）
+		/// @remark MessagePack のペイロードは s3d::JSON を経由せずに直接読み込みます
+		template <Serializable Type, class JSONProvider>
+		[[nodiscard]]
+		s3d::Optional<Type> DecodeValue(std::string_view payload, JSONProvider&& json)
+		{
+			Type value{};
+			if (IsBinary(payload))
+			{
+				MessagePackReader reader{ payload.substr(1) };
+				if (not PayloadTraits<Type>::Read(reader, value) || not reader.atEnd())
+				{
+					return s3d::none;
+				}
+				return value;
+			}
+
+			if (payload.empty() || not PayloadTraits<Type>::Read(json(), value))
+			{
+				return s3d::none;
+			}
+			return value;
+		}
+	}
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace MessageBus
+{
+	/// @brief Redis Cluster のハッシュスロット数
+	inline constexpr std::uint16_t CLUSTER_SLOT_COUNT = 16384;
+
+	namespace detail
+	{
+		// CRC16-CCITT (XMODEM) のテーブル
+		constexpr std::array<std::uint16_t, 256> MakeCrc16Table()
+		{
+			std::array<std::uint16_t, 256> table{};
+			for (std::uint32_t i = 0; i < 256; ++i)
+			{
+				std::uint16_t crc = static_cast<std::uint16_t>(i << 8);
+				for (int bit = 0; bit < 8; ++bit)
+				{
+					crc = (crc & 0x8000) ? static_cast<std::uint16_t>((crc << 1) ^ 0x1021) : static_cast<std::uint16_t>(crc << 1);
+				}
+				table[i] = crc;
+			}
+			return table;
+		}
+
+		inline constexpr std::array<std::uint16_t, 256> CRC16_TABLE = MakeCrc16Table();
+
+		constexpr std::uint16_t Crc16(std::string_view data) noexcept
+		{
+			std::uint16_t crc = 0;
+			for (const char ch : data)
+			{
+				crc = static_cast<std::uint16_t>((crc << 8) ^ CRC16_TABLE[((crc >> 8) ^ static_cast<std::uint8_t>(ch)) & 0xFF]);
+			}
+			return crc;
+		}
+	}
+
+	/// @brief キー（チャンネル名）のハッシュスロットを返します
+	/// @remark "{...}" のハッシュタグがある場合は、その中身のみでスロットを決めます（Redis Cluster と同じ規則）
+	[[nodiscard]]
+	constexpr std::uint16_t KeyHashSlot(std::string_view key) noexcept
+	{
+		if (const size_t open = key.find('{'); open != std::string_view::npos)
+		{
+			if (const size_t close = key.find('}', open + 1); close != std::string_view::npos && close != open + 1)
+			{
+				key = key.substr(open + 1, close - open - 1);
+			}
+		}
+		return static_cast<std::uint16_t>(detail::Crc16(key) % CLUSTER_SLOT_COUNT);
+	}
+
+	// Redis Cluster 仕様書のテストベクタ
+	static_assert(detail::Crc16("123456789") == 0x31C3);
+	static_assert(KeyHashSlot("{user1000}.following") == KeyHashSlot("{user1000}.followers"));
+}
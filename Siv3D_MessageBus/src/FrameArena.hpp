@@ -0,0 +1,113 @@
+﻿#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace MessageBus
+{
+	/// @brief フレーム単位で確保・一括解放するバンプアロケータ
+	/// @remark reset() はオフセットを巻き戻すだけで、確保済みのチャンクは次のフレームで再利用されます
+	class FrameArena
+	{
+	public:
+		explicit FrameArena(std::size_t chunkSize = 64 * 1024)
+			: m_chunkSize(chunkSize) {}
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		/// @brief size バイトの領域を確保します（次の reset() まで有効）
+		[[nodiscard]]
+		void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t))
+		{
+			for (;;)
+			{
+				if (m_current < m_chunks.size())
+				{
+					Chunk& chunk = m_chunks[m_current];
+					const std::size_t aligned = (m_offset + alignment - 1) & ~(alignment - 1);
+					if (aligned + size <= chunk.size)
+					{
+						m_offset = aligned + size;
+						m_used += size;
+						m_peak = std::max(m_peak, m_used);
+						return chunk.data.get() + aligned;
+					}
+
+					// 次のチャンクへ（残りは捨てる）
+					++m_current;
+					m_offset = 0;
+					continue;
+				}
+
+				// 足りない場合のみ上流から確保する
+				const std::size_t chunkSize = std::max(size + alignment, m_chunkSize << std::min<std::size_t>(m_chunks.size(), 8));
+				m_chunks.push_back(Chunk{ std::make_unique<std::byte[]>(chunkSize), chunkSize });
+				++m_chunkAllocations;
+			}
+		}
+
+		/// @brief 文字列をコピーし、アリーナ上のビューを返します
+		[[nodiscard]]
+		std::string_view copy(std::string_view str)
+		{
+			if (str.empty())
+			{
+				return {};
+			}
+			auto* dst = static_cast<char*>(allocate(str.size(), 1));
+			std::memcpy(dst, str.data(), str.size());
+			return { dst, str.size() };
+		}
+
+		/// @brief 全ての確保を一括で解放します（チャンクは保持）
+		void reset() noexcept
+		{
+			m_current = 0;
+			m_offset = 0;
+			m_used = 0;
+		}
+
+		/// @brief 現在のフレームで確保したバイト数
+		[[nodiscard]]
+		std::size_t used() const noexcept { return m_used; }
+
+		/// @brief 1フレームで確保した最大バイト数
+		[[nodiscard]]
+		std::size_t peak() const noexcept { return m_peak; }
+
+		/// @brief 保持しているチャンクの合計バイト数
+		[[nodiscard]]
+		std::size_t capacity() const noexcept
+		{
+			std::size_t total = 0;
+			for (const auto& chunk : m_chunks)
+			{
+				total += chunk.size;
+			}
+			return total;
+		}
+
+		/// @brief 上流（ヒープ）から確保した回数
+		[[nodiscard]]
+		std::size_t chunkAllocations() const noexcept { return m_chunkAllocations; }
+
+	private:
+		struct Chunk
+		{
+			std::unique_ptr<std::byte[]> data;
+			std::size_t size;
+		};
+
+		std::size_t m_chunkSize;
+		std::vector<Chunk> m_chunks;
+		std::size_t m_current = 0;
+		std::size_t m_offset = 0;
+		std::size_t m_used = 0;
+		std::size_t m_peak = 0;
+		std::size_t m_chunkAllocations = 0;
+	};
+}
@@ -0,0 +1,297 @@
+﻿#include "HiredisAllocator.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+extern "C" {
+#include <hiredis/alloc.h>
+}
+
+namespace MessageBus::HiredisAllocator
+{
+	namespace
+	{
+		// サイズクラス（ヘッダを除いた容量）
+		// redisReply 本体、要素配列、チャンネル名などの短い文字列、コマンド用の sds が収まるように刻む
+		constexpr std::array<std::size_t, 12> SIZE_CLASSES{ 16, 32, 48, 64, 96, 128, 192, 256, 512, 1024, 2048, 4096 };
+
+		// これより大きい確保（リーダーのバッファなど）は malloc に任せる
+		constexpr std::uint32_t LARGE_BLOCK = UINT32_MAX;
+
+		// スラブ1枚のサイズ
+		constexpr std::size_t SLAB_SIZE = 64 * 1024;
+
+		// malloc と同じアラインメントを保つため 16 バイトにする
+		struct alignas(16) BlockHeader
+		{
+			std::uint32_t sizeClass;
+			std::size_t size;
+		};
+		static_assert(sizeof(BlockHeader) == 16);
+
+		struct FreeBlock
+		{
+			FreeBlock* next;
+		};
+
+		struct SizeClassPool
+		{
+			std::mutex mutex;
+			FreeBlock* freeList = nullptr;
+		};
+
+		std::array<SizeClassPool, SIZE_CLASSES.size()> g_pools;
+
+		// どちらの確保関数を使うか（最初の接続で決まる）
+		enum class Mode
+		{
+			Undecided,
+			Default,
+			Pooled,
+		};
+		std::mutex g_modeMutex;
+		std::atomic<Mode> g_mode{ Mode::Undecided };
+
+		std::atomic<std::uint64_t> g_allocations{ 0 };
+		std::atomic<std::uint64_t> g_poolHits{ 0 };
+		std::atomic<std::uint64_t> g_upstreamAllocations{ 0 };
+		std::atomic<std::uint64_t> g_bytesInUse{ 0 };
+		std::atomic<std::uint64_t> g_peakBytesInUse{ 0 };
+		std::atomic<std::uint64_t> g_reservedBytes{ 0 };
+		std::atomic<std::uint64_t> g_peakReservedBytes{ 0 };
+
+		void UpdatePeak(std::atomic<std::uint64_t>& peak, std::uint64_t value) noexcept
+		{
+			std::uint64_t current = peak.load(std::memory_order_relaxed);
+			while (current < value &&
+				!peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		void AddReserved(std::size_t bytes) noexcept
+		{
+			const std::uint64_t reserved = g_reservedBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+			UpdatePeak(g_peakReservedBytes, reserved);
+		}
+
+		std::uint32_t FindSizeClass(std::size_t size) noexcept
+		{
+			const auto it = std::lower_bound(SIZE_CLASSES.begin(), SIZE_CLASSES.end(), size);
+			return (it == SIZE_CLASSES.end())
+				? LARGE_BLOCK
+				: static_cast<std::uint32_t>(it - SIZE_CLASSES.begin());
+		}
+
+		BlockHeader* HeaderOf(void* ptr) noexcept
+		{
+			return static_cast<BlockHeader*>(ptr) - 1;
+		}
+
+		// 空きリストから取り出す。空ならスラブを1枚確保して切り分ける
+		BlockHeader* PopBlock(std::uint32_t sizeClass)
+		{
+			SizeClassPool& pool = g_pools[sizeClass];
+			const std::size_t blockSize = sizeof(BlockHeader) + SIZE_CLASSES[sizeClass];
+
+			std::lock_guard lock{ pool.mutex };
+
+			if (pool.freeList)
+			{
+				FreeBlock* block = pool.freeList;
+				pool.freeList = block->next;
+				g_poolHits.fetch_add(1, std::memory_order_relaxed);
+				return reinterpret_cast<BlockHeader*>(block);
+			}
+
+			// スラブは解放せず、空きリストとして使い回す
+			auto* slab = static_cast<std::byte*>(std::malloc(SLAB_SIZE));
+			if (!slab)
+			{
+				return nullptr;
+			}
+			g_upstreamAllocations.fetch_add(1, std::memory_order_relaxed);
+			AddReserved(SLAB_SIZE);
+
+			const std::size_t blockCount = SLAB_SIZE / blockSize;
+			for (std::size_t i = 1; i < blockCount; ++i)
+			{
+				auto* block = reinterpret_cast<FreeBlock*>(slab + i * blockSize);
+				block->next = pool.freeList;
+				pool.freeList = block;
+			}
+			return reinterpret_cast<BlockHeader*>(slab);
+		}
+
+		void* Allocate(std::size_t size)
+		{
+			g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+			const std::uint32_t sizeClass = FindSizeClass(size);
+
+			BlockHeader* header;
+			if (sizeClass != LARGE_BLOCK)
+			{
+				header = PopBlock(sizeClass);
+			}
+			else
+			{
+				header = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + size));
+				if (header)
+				{
+					g_upstreamAllocations.fetch_add(1, std::memory_order_relaxed);
+					AddReserved(sizeof(BlockHeader) + size);
+				}
+			}
+
+			if (!header)
+			{
+				return nullptr;
+			}
+
+			header->sizeClass = sizeClass;
+			header->size = size;
+
+			const std::uint64_t inUse = g_bytesInUse.fetch_add(size, std::memory_order_relaxed) + size;
+			UpdatePeak(g_peakBytesInUse, inUse);
+
+			return header + 1;
+		}
+
+		void Free(void* ptr)
+		{
+			if (!ptr)
+			{
+				return;
+			}
+
+			BlockHeader* header = HeaderOf(ptr);
+			g_bytesInUse.fetch_sub(header->size, std::memory_order_relaxed);
+
+			if (header->sizeClass == LARGE_BLOCK)
+			{
+				g_reservedBytes.fetch_sub(sizeof(BlockHeader) + header->size, std::memory_order_relaxed);
+				std::free(header);
+				return;
+			}
+
+			SizeClassPool& pool = g_pools[header->sizeClass];
+			auto* block = reinterpret_cast<FreeBlock*>(header);
+
+			std::lock_guard lock{ pool.mutex };
+			block->next = pool.freeList;
+			pool.freeList = block;
+		}
+
+		void* Calloc(std::size_t count, std::size_t size)
+		{
+			if (size != 0 && count > SIZE_MAX / size)
+			{
+				return nullptr;
+			}
+
+			void* ptr = Allocate(count * size);
+			if (ptr)
+			{
+				std::memset(ptr, 0, count * size);
+			}
+			return ptr;
+		}
+
+		void* Realloc(void* ptr, std::size_t size)
+		{
+			if (!ptr)
+			{
+				return Allocate(size);
+			}
+
+			BlockHeader* header = HeaderOf(ptr);
+
+			// 同じブロックに収まる場合はそのまま使う
+			if (header->sizeClass != LARGE_BLOCK && size <= SIZE_CLASSES[header->sizeClass])
+			{
+				g_bytesInUse.fetch_add(size, std::memory_order_relaxed);
+				g_bytesInUse.fetch_sub(header->size, std::memory_order_relaxed);
+				header->size = size;
+				return ptr;
+			}
+
+			void* newPtr = Allocate(size);
+			if (!newPtr)
+			{
+				return nullptr;
+			}
+			std::memcpy(newPtr, ptr, std::min(header->size, size));
+			Free(ptr);
+			return newPtr;
+		}
+
+		char* Strdup(const char* str)
+		{
+			const std::size_t length = std::strlen(str) + 1;
+			auto* copy = static_cast<char*>(Allocate(length));
+			if (copy)
+			{
+				std::memcpy(copy, str, length);
+			}
+			return copy;
+		}
+	}
+
+	bool Install()
+	{
+		std::lock_guard lock{ g_modeMutex };
+		if (g_mode != Mode::Undecided)
+		{
+			return (g_mode == Mode::Pooled);
+		}
+
+		hiredisAllocFuncs funcs{
+			.mallocFn = Allocate,
+			.callocFn = Calloc,
+			.reallocFn = Realloc,
+			.strdupFn = Strdup,
+			.freeFn = Free,
+		};
+		hiredisSetAllocators(&funcs);
+		g_mode = Mode::Pooled;
+		return true;
+	}
+
+	void UseDefault()
+	{
+		// 既に決まっている場合はロックを取らない（接続を作るたびに呼ばれる）
+		if (g_mode.load(std::memory_order_acquire) != Mode::Undecided)
+		{
+			return;
+		}
+
+		std::lock_guard lock{ g_modeMutex };
+		if (g_mode == Mode::Undecided)
+		{
+			g_mode = Mode::Default;
+		}
+	}
+
+	bool IsPoolingEnabled() noexcept
+	{
+		return (g_mode.load(std::memory_order_acquire) == Mode::Pooled);
+	}
+
+	HiredisAllocatorCounters Counters() noexcept
+	{
+		return HiredisAllocatorCounters{
+			.allocations = g_allocations.load(std::memory_order_relaxed),
+			.poolHits = g_poolHits.load(std::memory_order_relaxed),
+			.upstreamAllocations = g_upstreamAllocations.load(std::memory_order_relaxed),
+			.bytesInUse = g_bytesInUse.load(std::memory_order_relaxed),
+			.peakBytesInUse = g_peakBytesInUse.load(std::memory_order_relaxed),
+			.reservedBytes = g_reservedBytes.load(std::memory_order_relaxed),
+			.peakReservedBytes = g_peakReservedBytes.load(std::memory_order_relaxed),
+		};
+	}
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+#include <cstdint>
+
+namespace MessageBus
+{
+	/// @brief hiredis の確保に関する集計値
+	struct HiredisAllocatorCounters
+	{
+		std::uint64_t allocations = 0;
+		std::uint64_t poolHits = 0;
+		std::uint64_t upstreamAllocations = 0;
+		std::uint64_t bytesInUse = 0;
+		std::uint64_t peakBytesInUse = 0;
+		std::uint64_t reservedBytes = 0;
+		std::uint64_t peakReservedBytes = 0;
+	};
+
+	/// @brief hiredis に登録する確保関数（サイズクラス別のスラブプールを持つ）
+	/// @remark 登録した関数は全ブロックの前にヘッダを置くため、既定の malloc で確保されたブロックを解放できません
+	/// @remark そのため、どちらを使うかはプロセスで最初の接続を作るときに決まり、以降は変更できません
+	namespace HiredisAllocator
+	{
+		/// @brief hiredisSetAllocators でプールを使う確保関数を登録します（登録済みの場合は何もしません）
+		/// @return 既に UseDefault() が呼ばれていて登録できない場合 false
+		[[nodiscard]]
+		bool Install();
+
+		/// @brief 既定の確保関数（malloc / free、集計なし）を使うことを確定します（Install() 済みの場合は何もしません）
+		/// @remark hiredis が既定の確保関数で確保する前（プールを使わない接続を作る前）に呼び出します
+		void UseDefault();
+
+		/// @brief プールが有効かを返します
+		[[nodiscard]]
+		bool IsPoolingEnabled() noexcept;
+
+		/// @brief 現在の集計値を返します（プールが無効の場合は全て 0）
+		[[nodiscard]]
+		HiredisAllocatorCounters Counters() noexcept;
+	}
+}
@@ -0,0 +1,188 @@
+﻿#include "HostResolver.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	include <WinSock2.h>
+#	include <WS2tcpip.h>
+#	pragma comment (lib, "Ws2_32.lib")
+#else
+#	include <arpa/inet.h>
+#	include <netdb.h>
+#	include <sys/socket.h>
+#endif
+
+namespace MessageBus::HostResolver
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		// 解決できたアドレスを使い続ける時間（期限切れ後も、再解決が終わるまでは古いアドレスを使う）
+		constexpr auto RESOLVED_TTL = std::chrono::seconds{ 60 };
+
+		// 解決に失敗した結果を使い続ける時間（再接続の最短間隔より短くし、次の再接続では解決し直す）
+		constexpr auto FAILED_TTL = std::chrono::seconds{ 2 };
+
+		struct Entry
+		{
+			HostResolveResult result;
+			Clock::time_point expiresAt;
+			bool resolving = false;
+		};
+
+		struct State
+		{
+			std::mutex mutex;
+			std::condition_variable requested;
+			std::unordered_map<std::string, Entry> entries;
+			std::deque<std::string> queue;
+			bool workerStarted = false;
+		};
+
+		// ワーカーは終了時に getaddrinfo で待たされないよう切り離すため、状態は共有所有にする
+		const std::shared_ptr<State>& GetState()
+		{
+			static const std::shared_ptr<State> state = std::make_shared<State>();
+			return state;
+		}
+
+		bool IsNumericAddress(const std::string& host)
+		{
+			unsigned char buffer[sizeof(in6_addr)];
+			return (::inet_pton(AF_INET, host.c_str(), buffer) == 1)
+				|| (::inet_pton(AF_INET6, host.c_str(), buffer) == 1);
+		}
+
+		std::string ErrorMessage(int code)
+		{
+#if defined(_WIN32)
+			// UNICODE 定義下では gai_strerror がワイド文字版になるため明示する
+			return ::gai_strerrorA(code);
+#else
+			return ::gai_strerror(code);
+#endif
+		}
+
+		HostResolveResult Resolve(const std::string& host)
+		{
+			addrinfo hints{};
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+
+			addrinfo* list = nullptr;
+			if (const int rc = ::getaddrinfo(host.c_str(), nullptr, &hints, &list); rc != 0)
+			{
+				return HostResolveResult{ .status = HostResolveStatus::Failed, .error = ErrorMessage(rc) };
+			}
+
+			// 以前の hiredis の解決と同じく、IPv4 のアドレスがあればそれを使う
+			const addrinfo* chosen = list;
+			for (const addrinfo* p = list; p; p = p->ai_next)
+			{
+				if (p->ai_family == AF_INET)
+				{
+					chosen = p;
+					break;
+				}
+			}
+
+			char address[NI_MAXHOST];
+			const int rc = ::getnameinfo(chosen->ai_addr, static_cast<socklen_t>(chosen->ai_addrlen), address, sizeof(address), nullptr, 0, NI_NUMERICHOST);
+			::freeaddrinfo(list);
+			if (rc != 0)
+			{
+				return HostResolveResult{ .status = HostResolveStatus::Failed, .error = ErrorMessage(rc) };
+			}
+
+			return HostResolveResult{ .status = HostResolveStatus::Resolved, .address = address };
+		}
+
+		void WorkerLoop(std::shared_ptr<State> state)
+		{
+#if defined(_WIN32)
+			WSADATA wsaData;
+			::WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+			std::unique_lock lock{ state->mutex };
+			for (;;)
+			{
+				state->requested.wait(lock, [&] { return not state->queue.empty(); });
+				const std::string host = std::move(state->queue.front());
+				state->queue.pop_front();
+
+				lock.unlock();
+				HostResolveResult result = Resolve(host);
+				lock.lock();
+
+				auto& entry = state->entries[host];
+				entry.expiresAt = Clock::now() + ((result.status == HostResolveStatus::Resolved) ? RESOLVED_TTL : FAILED_TTL);
+				entry.result = std::move(result);
+				entry.resolving = false;
+			}
+		}
+	}
+
+	HostResolveResult Lookup(std::string_view host)
+	{
+		std::string key{ host };
+		if (IsNumericAddress(key))
+		{
+			return HostResolveResult{ .status = HostResolveStatus::Resolved, .address = std::move(key) };
+		}
+
+		const auto& state = GetState();
+		std::lock_guard lock{ state->mutex };
+
+		auto& entry = state->entries[key];
+		if (entry.resolving)
+		{
+			return entry.result;
+		}
+
+		if (entry.result.status != HostResolveStatus::Pending && Clock::now() < entry.expiresAt)
+		{
+			return entry.result;
+		}
+
+		// 期限切れの失敗は使わずに解決し直す
+		if (entry.result.status == HostResolveStatus::Failed)
+		{
+			entry.result = HostResolveResult{};
+		}
+
+		entry.resolving = true;
+		state->queue.push_back(std::move(key));
+		if (not state->workerStarted)
+		{
+			std::thread{ WorkerLoop, state }.detach();
+			state->workerStarted = true;
+		}
+		state->requested.notify_one();
+		return entry.result;
+	}
+
+	void Invalidate(std::string_view host)
+	{
+		const auto& state = GetState();
+		std::lock_guard lock{ state->mutex };
+
+		// 解決中の場合は、その結果で置き換わる
+		if (auto it = state->entries.find(std::string{ host }); it != state->entries.end() && not it->second.resolving)
+		{
+			state->entries.erase(it);
+		}
+	}
+}
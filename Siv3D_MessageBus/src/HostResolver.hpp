@@ -0,0 +1,39 @@
+﻿#pragma once
+#include <string>
+#include <string_view>
+
+namespace MessageBus
+{
+	/// @brief ホスト名の解決状況
+	enum class HostResolveStatus
+	{
+		/// @brief バックグラウンドで解決中
+		Pending,
+
+		/// @brief 解決済み（address に数値のアドレスが入る）
+		Resolved,
+
+		/// @brief 解決に失敗した（error に理由が入る）
+		Failed,
+	};
+
+	struct HostResolveResult
+	{
+		HostResolveStatus status = HostResolveStatus::Pending;
+		std::string address;
+		std::string error;
+	};
+
+	/// @brief ホスト名をバックグラウンドのスレッドで解決し、結果を一定時間キャッシュする
+	/// @remark 呼び出し元のスレッドで getaddrinfo を待たないため、tick() から接続・再接続しても固まりません
+	namespace HostResolver
+	{
+		/// @brief ホスト名の解決結果を返します（キャッシュが無いか期限切れの場合は解決を始めて Pending を返します）
+		/// @remark 数値のアドレスはそのまま Resolved を返します。期限切れの間も、再解決が終わるまでは古い結果を返します
+		[[nodiscard]]
+		HostResolveResult Lookup(std::string_view host);
+
+		/// @brief キャッシュを破棄し、次の Lookup() で解決し直すようにします（接続に失敗した場合などに使います）
+		void Invalidate(std::string_view host);
+	}
+}
@@ -0,0 +1,183 @@
+﻿#pragma once
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace MessageBus
+{
+	// 偽共有を避けるためのアラインメント
+	inline constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+	/// @brief 固定長のロックフリー MPSC キュー（複数スレッドから push、単一スレッドから pop）
+	/// @remark D. Vyukov の bounded MPMC queue を単一コンシューマ向けに簡略化したもの
+	template <class Type>
+	class BoundedMPSCQueue
+	{
+	public:
+		/// @param capacity 最大要素数（2のべき乗に切り上げられます）
+		explicit BoundedMPSCQueue(std::size_t capacity)
+			: m_capacity(std::bit_ceil(capacity < 2 ? std::size_t{ 2 } : capacity))
+			, m_mask(m_capacity - 1)
+			, m_cells(std::make_unique<Cell[]>(m_capacity))
+		{
+			for (std::size_t i = 0; i < m_capacity; ++i)
+			{
+				m_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		BoundedMPSCQueue(const BoundedMPSCQueue&) = delete;
+		BoundedMPSCQueue& operator=(const BoundedMPSCQueue&) = delete;
+
+		/// @brief 要素を追加します（任意のスレッドから呼び出し可能）
+		/// @return キューが満杯の場合 false
+		bool tryPush(Type&& value)
+		{
+			Cell* cell;
+			std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				cell = &m_cells[pos & m_mask];
+				const std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+				const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+				if (diff == 0)
+				{
+					if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = m_enqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+
+			cell->value = std::move(value);
+			cell->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		/// @brief 要素を取り出します（コンシューマスレッドのみ）
+		/// @return キューが空の場合 false
+		bool tryPop(Type& out)
+		{
+			Cell& cell = m_cells[m_dequeuePos & m_mask];
+			const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+			if (seq != m_dequeuePos + 1)
+			{
+				return false;
+			}
+
+			out = std::move(cell.value);
+			cell.sequence.store(m_dequeuePos + m_capacity, std::memory_order_release);
+			++m_dequeuePos;
+			return true;
+		}
+
+		[[nodiscard]]
+		std::size_t capacity() const noexcept { return m_capacity; }
+
+	private:
+		struct Cell
+		{
+			std::atomic<std::size_t> sequence;
+			Type value;
+		};
+
+		const std::size_t m_capacity;
+		const std::size_t m_mask;
+		std::unique_ptr<Cell[]> m_cells;
+
+		alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_enqueuePos{ 0 };
+		alignas(CACHE_LINE_SIZE) std::size_t m_dequeuePos = 0;
+	};
+
+	/// @brief 固定長のロックフリー SPSC リングバッファ（単一スレッドから push、単一スレッドから pop）
+	template <class Type>
+	class SPSCRingBuffer
+	{
+	public:
+		/// @param capacity 最大要素数（2のべき乗に切り上げられます）
+		explicit SPSCRingBuffer(std::size_t capacity)
+			: m_capacity(std::bit_ceil(capacity < 2 ? std::size_t{ 2 } : capacity))
+			, m_mask(m_capacity - 1)
+			, m_buffer(std::make_unique<Type[]>(m_capacity))
+		{
+		}
+
+		SPSCRingBuffer(const SPSCRingBuffer&) = delete;
+		SPSCRingBuffer& operator=(const SPSCRingBuffer&) = delete;
+
+		/// @brief 要素を追加します（プロデューサスレッドのみ）
+		/// @return バッファが満杯の場合 false
+		bool tryPush(Type&& value)
+		{
+			const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_headCache == m_capacity)
+			{
+				m_headCache = m_head.load(std::memory_order_acquire);
+				if (tail - m_headCache == m_capacity)
+				{
+					return false;
+				}
+			}
+
+			m_buffer[tail & m_mask] = std::move(value);
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		/// @brief 要素を取り出します（コンシューマスレッドのみ）
+		/// @return バッファが空の場合 false
+		bool tryPop(Type& out)
+		{
+			const std::size_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tailCache)
+			{
+				m_tailCache = m_tail.load(std::memory_order_acquire);
+				if (head == m_tailCache)
+				{
+					return false;
+				}
+			}
+
+			out = std::move(m_buffer[head & m_mask]);
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		[[nodiscard]]
+		std::size_t capacity() const noexcept { return m_capacity; }
+
+		/// @brief 格納されている要素数の概算値（他方のスレッドが操作中の場合は古い値になり得ます）
+		[[nodiscard]]
+		std::size_t sizeApprox() const noexcept
+		{
+			// head を先に読むことで tail - head が負にならないようにする
+			const std::size_t head = m_head.load(std::memory_order_acquire);
+			const std::size_t tail = m_tail.load(std::memory_order_acquire);
+			return tail - head;
+		}
+
+	private:
+		const std::size_t m_capacity;
+		const std::size_t m_mask;
+		std::unique_ptr<Type[]> m_buffer;
+
+		// コンシューマ側
+		alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_head{ 0 };
+		std::size_t m_tailCache = 0;
+
+		// プロデューサ側
+		alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_tail{ 0 };
+		std::size_t m_headCache = 0;
+	};
+}
@@ -1,8 +1,23 @@
 #include "MessageBus/MessageBus.hpp"
 #include "MessageBus/RedisConnection.hpp"
+#include "LockFreeQueue.hpp"
+#include "FrameArena.hpp"
+#include "RedisMessageReader.hpp"
+#include "HiredisAllocator.hpp"
+#include "TopicTrie.hpp"
+#include "ClusterSlot.hpp"
+#include "SharedMemoryRing.hpp"
 #include <Siv3D/Logger.hpp>
 #include <Siv3D/Unicode.hpp>
 #include <Siv3D/HashTable.hpp>
+#include <Siv3D/Utility.hpp>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
 
 extern "C" {
 #include <hiredis/async.h>
@@ -17,133 +32,2301 @@ namespace MessageBus
 		return not channel.empty();
 	}
 
+	// プロセスやインスタンスごとに異なる送信元タグを作る
+	static std::string MakeOriginTag()
+	{
+		std::random_device device;
+		const uint64 origin = (static_cast<uint64>(device()) << 32) ^ device();
+
+		std::string tag(ORIGIN_TAG_SIZE, '\0');
+		tag[0] = static_cast<char>(ORIGIN_TAG_MARKER);
+		for (size_t i = 1; i < ORIGIN_TAG_SIZE; ++i)
+		{
+			tag[i] = static_cast<char>(origin >> (8 * (ORIGIN_TAG_SIZE - 1 - i)));
+		}
+		return tag;
+	}
+
+	// I/Oスレッドが1回のループでソケットを待機する最大時間
+	constexpr Duration IO_POLL_INTERVAL = MillisecondsF{ 1 };
+
+	// FireAndForget モードで PUBLISH エラーをログに出す最小間隔
+	constexpr Duration PUBLISH_ERROR_LOG_INTERVAL = Seconds{ 1 };
+
+	// ストリームチャンネルの XREAD がサーバー側で待機する最大時間（新しく購読したストリームはこの間隔で読み込みに加わる）
+	constexpr Duration STREAM_BLOCK_TIMEOUT = MillisecondsF{ 100 };
+
+	// XREAD がエラーになった場合に再試行するまでの時間
+	constexpr Duration STREAM_RETRY_INTERVAL = Seconds{ 1 };
+
+	// 共有メモリから1回の読み込みで取り出す最大件数
+	constexpr size_t SHARED_MEMORY_READ_BATCH = 256;
+
+	// パターンのみで受信したチャンネル（インターンしない）の ChannelInfo::index
+	constexpr uint32 UNLISTED_CHANNEL_INDEX = 0xFFFFFFFEu;
+
 	struct MessageBus::Impl
 	{
-		RedisConnection conn;
+		// ハブに接続した MessageBus では null（通信はハブが行う）
+		// 破棄時の切断コールバックが後ろのメンバーに触れるため、~Impl() で先に破棄する
+		std::unique_ptr<RedisConnection> conn;
+
+		const bool threaded;
+
+		static constexpr uint16 NoShard = 0xFFFF;
 
 		struct ChannelState
 		{
 			bool desired = false; // ユーザーの購読意図
 			bool remote = false;  // サーバー側で購読確定
+
+			// インターン済みの情報（ChannelId が指す先。購読解除後も破棄しない）
+			std::unique_ptr<ChannelInfo> info;
+
+			// subscribe(channel, handler) で登録されたハンドラ
+			s3d::Array<EventHandler> handlers;
+
+			ReceiveMode receiveMode = ReceiveMode::All;
+
+			// パターン購読の場合、PSUBSCRIBE に使う glob
+			std::string glob;
+
+			// クラスタモードで SSUBSCRIBE したシャード
+			uint16 remoteShard = NoShard;
+
+			// declareStream() されたチャンネル（SUBSCRIBE せず XREAD で読み込む）
+			bool stream = false;
+
+			// 読み込んだ最後のエントリID（空の場合は未取得。購読を解除すると破棄する）
+			std::string lastId;
+			bool lastIdPending = false;
 		};
 
 		s3d::HashTable<std::string, ChannelState> channels;
 		bool channelsDirty = false;
 
-		s3d::Array<MessageBus::Event> eventsBuf;
+		// psubscribe() されたパターン（ChannelInfo::index は channels と共通の番号を使う）
+		s3d::HashTable<std::string, ChannelState> patterns;
 
-		Impl(s3d::StringView ip, s3d::uint16 port, s3d::Optional<s3d::StringView> password)
-			: conn(RedisConnectionOptions{
-				.ip = ip,
-				.port = port,
-				.password = password,
+		// channels と patterns で発行した ChannelInfo::index の数
+		uint32 channelCount = 0;
+
+		// 購読中のパターンをまとめた照合用の木（パターンが変わったら次の受信時に作り直す）
+		struct CompiledPattern
+		{
+			ChannelId pattern;
+			std::string glob;
+		};
+		TopicTrie patternTrie;
+		s3d::Array<CompiledPattern> compiledPatterns;
+		bool patternTrieDirty = false;
+
+		// サーバー側で PSUBSCRIBE 済みの glob（昇順）
+		s3d::Array<std::string> remoteGlobs;
+
+		// 照合で一致したパターンの一時バッファ（受信を行うスレッドのみが触る）
+		s3d::Array<ChannelId> matchedPatterns;
+
+		// ハンドラの登録/解除、受信モードの変更ごとに増える（dispatchTable の再構築判定に使う）
+		uint64 handlersVersion = 0;
+
+		// tick() を呼ぶスレッドのみが触る、ChannelInfo::index で引くハンドラ表と受信モード表
+		s3d::Array<s3d::Array<EventHandler>> dispatchTable;
+		s3d::Array<ReceiveMode> receiveModes;
+		uint64 dispatchVersion = 0;
+
+		// channels / patterns / channelsDirty を保護（スレッドモードではI/Oスレッドからも参照される）
+		mutable std::mutex channelsMutex;
+
+		// 受信イベントは ChannelInfo::index ごとのバッファに振り分けて格納し、受信順は eventOrder で保持する
+		s3d::Array<s3d::Array<MessageBus::Event>> eventBuckets;
+		s3d::Array<MessageBus::EventRef> eventOrder;
+
+		// 受信イベントのペイロードを格納するフレームアリーナ（tick() の先頭で一括解放）
+		FrameArena frameArena;
+
+		// パターンのみで受信したチャンネルの情報（インターンせず、tick() の先頭で破棄する）
+		std::deque<ChannelInfo> frameChannels;
+		s3d::HashTable<std::string, const ChannelInfo*> frameChannelIndex;
+
+		// 1回の tick() で events() に渡す最大イベント数
+		size_t eventLimit = SIZE_MAX;
+
+		struct OutboundEvent
+		{
+			std::string channel;
+			std::string payload;
+		};
+
+		// 任意のスレッドの emit() から積まれ、drainOutbound() の1箇所で hiredis へ流す
+		BoundedMPSCQueue<OutboundEvent> outboundQueue;
+
+		// setEmitOptions() で設定された送信オプション（任意のスレッドから設定される）
+		s3d::HashTable<std::string, EmitOptions> emitOptions;
+		std::mutex emitOptionsMutex;
+		std::atomic<uint64> emitOptionsVersion{ 0 };
+
+		// declareStream() で宣言されたストリームチャンネル（emitOptionsMutex で保護し、emitOptionsVersion で通知する）
+		s3d::HashTable<std::string, StreamOptions> streamOptions;
+
+		// 送信オプションが設定されたチャンネルの状態（drainOutbound() を呼ぶスレッドのみが触る）
+		struct OutboundChannel
+		{
+			std::string channel;
+			EmitOptions options;
+
+			// トークンバケット
+			double tokens = 0.0;
+			double lastRefill = 0.0;
+
+			// coalesce で保留中の最新の値
+			bool hasPending = false;
+			std::string pending;
+
+			bool tryTakeToken(double now)
+			{
+				if (options.rateLimit <= 0.0)
+				{
+					return true;
+				}
+
+				tokens = Min(Max(options.burst, 1.0), tokens + (now - lastRefill) * options.rateLimit);
+				lastRefill = now;
+				if (tokens < 1.0)
+				{
+					return false;
+				}
+				tokens -= 1.0;
+				return true;
+			}
+		};
+		s3d::HashTable<std::string, OutboundChannel> outboundChannels;
+		s3d::HashTable<std::string, StreamOptions> outboundStreams;
+		s3d::Array<OutboundChannel*> pendingChannels;
+		uint64 outboundOptionsVersion = 0;
+		s3d::Stopwatch outboundClock{ StartImmediately::Yes };
+
+		// tick() ごとに増える（スレッドモードで coalesce の送信をフレーム単位にするために使う）
+		std::atomic<uint64> frameCount{ 0 };
+		uint64 flushedFrame = 0;
+
+		const bool batchedPublish;
+
+		const DeliveryMode deliveryMode;
+
+		const PayloadFormat payloadFormat;
+
+		// ローカル配送（送信したイベントを自分の購読に直接渡し、Redis からの戻りは送信元タグで破棄する）
+		const bool localDelivery;
+		const std::string originTag;
+
+		// 送信元タグを付けたペイロード（drainOutbound() を呼ぶスレッドのみが触る）
+		std::string taggedPayload;
+
+		// PUBLISH の集計（I/Oスレッドからも更新されるため atomic）
+		struct PublishCounters
+		{
+			std::atomic<uint64> sent{ 0 };
+			std::atomic<uint64> replied{ 0 };
+			std::atomic<uint64> delivered{ 0 };
+			std::atomic<uint64> errors{ 0 };
+			std::atomic<uint64> coalesced{ 0 };
+			std::atomic<uint64> rateLimited{ 0 };
+			std::atomic<uint64> dropped{ 0 };
+
+			// エラーログの間引き（応答ハンドラのスレッドのみが触る）
+			s3d::Stopwatch errorLogTimer;
+			uint64 errorsSinceLastLog = 0;
+		};
+		PublishCounters publishCounters;
+
+		// drainOutbound() で組み立てた PUBLISH コマンド列（フレームをまたいで再利用）
+		std::string publishBuffer;
+		s3d::Array<size_t> publishOffsets;
+
+		// ================================
+		// スレッドモード用の状態
+		// ================================
+
+		// I/Oスレッドが受信したメッセージ（tick() でフレームアリーナへ移してから Event にする）
+		struct InboundMessage
+		{
+			ChannelId channel;
+			ChannelId pattern;
+			std::string payload;
+
+			// channel が無効な場合（パターンのみで受信したチャンネル）のチャンネル名
+			std::string channelName;
+		};
+
+		// I/Oスレッド → tick() を呼ぶスレッドへの受信メッセージ
+		SPSCRingBuffer<InboundMessage> inboundQueue;
+
+		// eventLimit を超えて次の tick() に持ち越したメッセージ（tick() を呼ぶスレッドのみが触る）
+		std::deque<InboundMessage> backlog;
+
+		// これまでに backlog から取り出した数（backlog の要素の通し番号の基準）
+		uint64 backlogHead = 0;
+
+		// ReceiveMode::LatestOnly のバッファごとの、持ち越し中のメッセージの通し番号 + 1（0 は無し）
+		s3d::Array<uint64> latestBacklogPos;
+
+		// I/Oスレッドのみが触る受信バッファ（inboundQueue が満杯の間はここに溜めておく）
+		s3d::Array<InboundMessage> ioEventsBuf;
+
+		// エラー文字列の受け渡し（sharedMutex で保護）
+		std::mutex sharedMutex;
+		s3d::String sharedError;
+
+		// メインスレッドから参照する接続状態のスナップショット
+		std::atomic<RedisConnectionState> connState{ RedisConnectionState::Disconnected };
+		s3d::String errorSnapshot;
+
+		std::atomic<bool> closeRequested{ false };
+
+		// close() で全ての接続を切断した（I/O を行うスレッドのみが触る）
+		bool closed = false;
+
+		// ================================
+		// クラスタモード用の状態（I/O を行うスレッドのみが触る）
+		// ================================
+
+		const bool cluster;
+
+		// ハッシュスロット → shards の添字
+		std::array<uint16, CLUSTER_SLOT_COUNT> slotOwners;
+		bool slotMapReady = false;
+
+		// CLUSTER SLOTS の再取得（MOVED やサーバー側からの sunsubscribe を受けたときに要求する）
+		bool slotRefreshRequested = false;
+		bool slotRefreshInFlight = false;
+
+		// マスターノードごとの接続（破棄時の切断コールバックが他のメンバーに触れるため、後ろに置く）
+		struct Shard
+		{
+			s3d::String host;
+			uint16 port;
+			std::unique_ptr<RedisConnection> conn;
+		};
+		s3d::Array<std::unique_ptr<Shard>> shards;
+
+		// ================================
+		// ストリームチャンネル用の状態（I/O を行うスレッドのみが触る）
+		// ================================
+
+		const size_t streamReadCount;
+
+		// 最初の declareStream() で立ち、I/O を行うスレッドが読み込み用の接続を作る
+		std::atomic<bool> streamsDeclared{ false };
+
+		// XREAD を待機させる専用の接続（破棄時の切断コールバックが他のメンバーに触れるため、後ろに置く）
+		std::unique_ptr<RedisConnection> streamConn;
+		bool streamReadInFlight = false;
+		double streamReadResumeAt = 0.0;
+
+		// ================================
+		// 共有ハブ用の状態
+		// ================================
+
+		// MessageBusHub が持つ Impl の場合 true（受信したメッセージは自分では保持せず、接続している MessageBus に配る）
+		const bool isHub;
+
+		// ハブに接続した MessageBus の受信キューの容量
+		const size_t inboundQueueCapacity;
+
+		// ハブ: 接続している MessageBus（frontEndsMutex で保護。I/Oスレッドはこれを保持したまま配送する）
+		std::mutex frontEndsMutex;
+		s3d::Array<Impl*> frontEnds;
+
+		// ハブ: アプリケーションのフレームの通し番号（frontEndsMutex で保護。進めるたびに frameCount も進める）
+		uint64 frontEndFrame = 1;
+
+		// ハブに接続した MessageBus: 最後に tick() したときのハブの frontEndFrame（ハブの frontEndsMutex で保護）
+		uint64 tickedHubFrame = 0;
+
+		// ハブ: チャンネル/パターンごとの購読している MessageBus の数（refsMutex で保護）
+		std::mutex refsMutex;
+		s3d::HashTable<std::string, uint32> channelRefs;
+		s3d::HashTable<std::string, uint32> patternRefs;
+
+		// ハブに接続した MessageBus: 接続先のハブ（全ての MessageBus が破棄されるまでハブを生かしておく）
+		std::shared_ptr<Impl> hub;
+
+		// ================================
+		// 共有メモリ用の状態（I/O を行うスレッドのみが触る）
+		// ================================
+
+		// Transport::SharedMemory の場合のみ作る（conn は null）
+		std::unique_ptr<SharedMemoryRing> sharedMemory;
+
+		// ログに出した時点の追い越された件数
+		uint64 reportedDrops = 0;
+
+		// 最後に破棄されるよう末尾に置く（破棄時に停止・合流する）
+		std::jthread ioThread;
+
+		Impl(const MessageBusOptions& options, bool asHub = false)
+			: conn((options.transport != Transport::Redis) ? nullptr : std::make_unique<RedisConnection>(RedisConnectionOptions{
+				.ip = options.ip,
+				.port = options.port,
+				.password = options.password,
+				.unixSocket = options.unixSocket,
 				.heartbeatInterval = s3d::Seconds{ 10 },
+				.pooledAllocator = options.pooledAllocator,
 				.onConnect = nullptr,
-				.onReady = [this](redisAsyncContext* context) { reconcileSubscriptions(context); },
-				.onDisconnect = [this]() { markAllUnsubscribed(); }
-			})
+				.onReady = [this](redisAsyncContext* context) { onControlReady(context); },
+				.onDisconnect = [this]() { markAllUnsubscribed(); },
+				.onMessage = [this](std::string_view pattern, std::string_view channel, std::string_view payload) { onMessage(pattern, channel, payload); }
+			}))
+			, threaded(options.threaded || asHub)
+			, outboundQueue(options.outboundQueueCapacity)
+			, batchedPublish(options.batchedPublish)
+			, deliveryMode(options.deliveryMode)
+			, payloadFormat(options.payloadFormat)
+			, localDelivery(options.localDelivery)
+			, originTag(options.localDelivery ? MakeOriginTag() : std::string{})
+			, inboundQueue((options.threaded && not asHub) ? options.inboundQueueCapacity : 0)
+			, cluster(options.cluster && (options.transport == Transport::Redis))
+			, streamReadCount(Max<size_t>(options.streamReadCount, 1))
+			, isHub(asHub)
+			, inboundQueueCapacity(options.inboundQueueCapacity)
 		{
+			slotOwners.fill(NoShard);
+
+			if (conn)
+			{
+				connState = conn->state();
+			}
+			else
+			{
+				sharedMemory = std::make_unique<SharedMemoryRing>(Unicode::ToUTF8(options.sharedMemoryName), options.sharedMemorySlotCount, options.sharedMemorySlotSize);
+				if (sharedMemory->isOpen())
+				{
+					connState = RedisConnectionState::Connected;
+				}
+				else
+				{
+					connState = RedisConnectionState::Failed;
+					sharedError = Unicode::FromUTF8(sharedMemory->error());
+				}
+			}
+
+			if (threaded)
+			{
+				ioThread = std::jthread{ [this](std::stop_token stopToken) { ioLoop(stopToken); } };
+			}
 		}
 
-		void clearEventsBuffer()
+		// ハブに接続する MessageBus（接続を持たず、受信はハブのI/Oスレッドから受け取る）
+		explicit Impl(std::shared_ptr<Impl> hubImpl)
+			: threaded(true)
+			, outboundQueue(0)
+			, batchedPublish(hubImpl->batchedPublish)
+			, deliveryMode(hubImpl->deliveryMode)
+			, payloadFormat(hubImpl->payloadFormat)
+			, localDelivery(false)
+			, inboundQueue(hubImpl->inboundQueueCapacity)
+			, cluster(false)
+			, streamReadCount(hubImpl->streamReadCount)
+			, isHub(false)
+			, inboundQueueCapacity(hubImpl->inboundQueueCapacity)
+			, hub(std::move(hubImpl))
 		{
-			eventsBuf.clear();
+			slotOwners.fill(NoShard);
+			connState = hub->connState.load();
+
+			std::lock_guard lock{ hub->frontEndsMutex };
+			hub->frontEnds.push_back(this);
 		}
 
-		static void onSubscriptionMessageReceive(redisAsyncContext*, redisReply* reply, Impl* self)
+		~Impl()
 		{
-			// 事前条件チェック
-			if (!reply || reply->type != REDIS_REPLY_PUSH || reply->elements < 3) return;
+			// I/Oスレッドを止めてから、channelsMutex などが破棄される前に接続を破棄する（切断コールバックが markAllUnsubscribed() を呼ぶ）
+			if (ioThread.joinable())
+			{
+				ioThread.request_stop();
+				ioThread.join();
+			}
+			conn.reset();
 
-			// 型チェック
-			redisReply* kindElem = reply->element[0];
-			redisReply* channelElem = reply->element[1];
-			redisReply* payloadElem = reply->element[2];
-			if (!kindElem ||
-				kindElem->type != REDIS_REPLY_STRING ||
-				!channelElem ||
-				channelElem->type != REDIS_REPLY_STRING ||
-				!payloadElem ||
-				payloadElem->type != REDIS_REPLY_STRING)
+			if (not hub)
 			{
 				return;
 			}
 
-			const std::string_view kind{ kindElem->str, kindElem->len };
-			const std::string_view channelName{ channelElem->str, channelElem->len };
-			const std::string_view payload{ payloadElem->str, payloadElem->len };
+			// ハブのI/Oスレッドから配送されなくなってから、購読していたチャンネルの参照を返す
+			{
+				std::lock_guard lock{ hub->frontEndsMutex };
+				hub->frontEnds.remove(this);
+			}
+
+			std::lock_guard lock{ channelsMutex };
+			for (const auto& [key, st] : channels)
+			{
+				if (st.remote)
+				{
+					hub->releaseShared(key, false);
+				}
+			}
+			for (const auto& [key, st] : patterns)
+			{
+				if (st.remote)
+				{
+					hub->releaseShared(key, true);
+				}
+			}
+		}
+
+		// 送信キューと送信オプションを持つ Impl（ハブに接続している場合はハブ）
+		Impl& publisher() noexcept
+		{
+			return hub ? *hub : *this;
+		}
+
+		void clearEventsBuffer()
+		{
+			// イベントが入ったバッファのみクリアする（容量は次のフレームで再利用）
+			for (const auto& ref : eventOrder)
+			{
+				eventBuckets[ref.bucket].clear();
+			}
+			eventOrder.clear();
+
+			// イベントが参照していたペイロードとチャンネルの情報をまとめて解放する
+			frameArena.reset();
+			frameChannels.clear();
+			frameChannelIndex.clear();
+		}
+
+		// 受信したメッセージを追加する（上限に達している、または持ち越し分が残っている場合は持ち越す）
+		void pushEvent(ChannelId channel, ChannelId pattern, std::string_view payload, std::string_view channelName = {})
+		{
+			// 最新のみのチャンネルは、このフレームのイベントがあれば上限に関係なく置き換える
+			if (replaceLatest(channel, pattern, payload, channelName))
+			{
+				return;
+			}
 
-			// メッセージのみ処理
-			if (kind != "message")
+			if (eventLimit <= eventOrder.size() || not backlog.empty())
 			{
+				// 最新のみのチャンネルは、次に届いたときに置き換えられるよう位置を覚えておく
+				if (const uint32 bucket = BucketOf(channel, pattern); isLatestOnly(bucket))
+				{
+					if (latestBacklogPos.size() <= bucket)
+					{
+						latestBacklogPos.resize(bucket + 1, 0);
+					}
+					latestBacklogPos[bucket] = backlogHead + backlog.size() + 1;
+				}
+				backlog.push_back(InboundMessage{ channel, pattern, std::string{ payload }, std::string{ channelName } });
 				return;
 			}
 
-			// 購読中のチャンネルのみ処理
-			auto channelItr = self->channels.find(channelName);
-			if (channelItr == self->channels.end() ||
-				!channelItr->second.desired)
+			appendEvent(channel, pattern, payload, channelName);
+		}
+
+		// 前回までに持ち越したメッセージを上限まで取り出す
+		void takeBacklog()
+		{
+			while (not backlog.empty() && eventOrder.size() < eventLimit)
+			{
+				// 取り出したものが持ち越し中の置き換え先にならないよう、先に backlog から外す
+				const InboundMessage message = std::move(backlog.front());
+				backlog.pop_front();
+				++backlogHead;
+				appendEvent(message.channel, message.pattern, message.payload, message.channelName);
+			}
+		}
+
+		bool isLatestOnly(uint32 bucket) const noexcept
+		{
+			return (bucket < receiveModes.size()) && (receiveModes[bucket] == ReceiveMode::LatestOnly);
+		}
+
+		// ReceiveMode::LatestOnly のチャンネルに今回のイベントか持ち越し中のメッセージがあれば、受信順の位置を保ったまま内容を置き換える
+		bool replaceLatest(ChannelId channel, ChannelId pattern, std::string_view payload, std::string_view channelName = {})
+		{
+			const uint32 bucket = BucketOf(channel, pattern);
+			if (not isLatestOnly(bucket))
+			{
+				return false;
+			}
+
+			if (bucket < eventBuckets.size() && not eventBuckets[bucket].isEmpty())
+			{
+				// 置き換えられたペイロードはパースされないまま、アリーナごと次の tick() で解放される
+				eventBuckets[bucket].front() = MessageBus::Event{ (channel ? channel : frameChannel(channelName)), frameArena.copy(payload), pattern };
+				return true;
+			}
+
+			// 持ち越し中のものがあれば、後の tick() で古い値が渡されないようそちらを置き換える
+			if (bucket < latestBacklogPos.size() && backlogHead < latestBacklogPos[bucket])
+			{
+				InboundMessage& pending = backlog[static_cast<size_t>(latestBacklogPos[bucket] - 1 - backlogHead)];
+				pending.channel = channel;
+				pending.pattern = pattern;
+				pending.payload.assign(payload);
+				pending.channelName.assign(channelName);
+				return true;
+			}
+			return false;
+		}
+
+		// イベントを格納するバッファ（パターン購読ではパターンごと）
+		static uint32 BucketOf(ChannelId channel, ChannelId pattern) noexcept
+		{
+			return pattern ? pattern.index() : channel.index();
+		}
+
+		// payload をフレームアリーナへコピーしてイベントを追加する
+		void appendEvent(ChannelId channel, ChannelId pattern, std::string_view payload, std::string_view channelName = {})
+		{
+			if (not channel)
+			{
+				channel = frameChannel(channelName);
+			}
+
+			if (replaceLatest(channel, pattern, payload))
 			{
 				return;
 			}
 
-			// イベントバッファに追加（空/失敗時は Invalid）
-			self->eventsBuf.emplace_back(MessageBus::Event{
-				.channel = Unicode::FromUTF8(channelName),
-				.value = payload.empty() ? JSON::Invalid() : JSON::Parse(Unicode::FromUTF8(payload))
+			MessageBus::Event event{ channel, frameArena.copy(payload), pattern };
+
+			const uint32 bucket = BucketOf(channel, pattern);
+			if (eventBuckets.size() <= bucket)
+			{
+				eventBuckets.resize(bucket + 1);
+			}
+
+			auto& events = eventBuckets[bucket];
+			eventOrder.push_back(MessageBus::EventRef{ bucket, static_cast<uint32>(events.size()) });
+			events.push_back(std::move(event));
+		}
+
+		// パターンのみで受信したチャンネルの、次の tick() まで有効な情報（同じ tick() では同じものを返す）
+		ChannelId frameChannel(std::string_view u8channel)
+		{
+			if (auto it = frameChannelIndex.find(u8channel); it != frameChannelIndex.end())
+			{
+				return ChannelId{ it->second };
+			}
+
+			const ChannelInfo& info = frameChannels.emplace_back(ChannelInfo{
+				.index = UNLISTED_CHANNEL_INDEX,
+				.name = Unicode::FromUTF8(u8channel),
+				.utf8Name = std::string{ u8channel }
 			});
+			frameChannelIndex.emplace(info.utf8Name, &info);
+			return ChannelId{ &info };
 		}
 
-		void markAllUnsubscribed()
+		std::span<const MessageBus::Event> eventsOf(ChannelId channel) const
 		{
-			for (auto& [key, st] : channels)
+			const uint32 bucket = channel.index();
+			if (not channel || eventBuckets.size() <= bucket)
 			{
-				st.remote = false;
+				return {};
 			}
-			channelsDirty = true;
+			return eventBuckets[bucket];
 		}
 
-		void reconcileSubscriptions(redisAsyncContext* context)
+		// ================================
+		// I/Oスレッド
+		// ================================
+
+		void ioLoop(std::stop_token stopToken)
 		{
-			if (!context) return;
+			while (not stopToken.stop_requested())
+			{
+				if (sharedMemory)
+				{
+					// 待機できるソケットが無いため、届いていなければ少し眠る
+					if (not tickSharedMemory(SHARED_MEMORY_READ_BATCH))
+					{
+						std::this_thread::sleep_for(IO_POLL_INTERVAL);
+					}
+				}
+				else
+				{
+					tickRedisIo();
+				}
 
-			// コマンド構築
-			std::vector<std::string_view> subscribeCommand{ {"SUBSCRIBE"} };
-			std::vector<std::string_view> unsubscribeCommand{ {"UNSUBSCRIBE"} };
-			for (const auto& [key, st] : channels)
+				if (isHub)
+				{
+					std::lock_guard lock{ frontEndsMutex };
+					for (auto* frontEnd : frontEnds)
+					{
+						frontEnd->flushIoEvents();
+					}
+				}
+				else
+				{
+					flushIoEvents();
+				}
+			}
+		}
+
+		// I/Oスレッドの1回分の Redis の読み書き
+		void tickRedisIo()
+		{
+			if (closeRequested.exchange(false))
 			{
-				if (st.desired && !st.remote)
+				closeConnections();
+			}
+
+			if (conn->state() == RedisConnectionState::Connected)
+			{
+				if (isChannelsDirty())
 				{
-					subscribeCommand.push_back(key);
+					reconcileSubscriptions(conn->context());
 				}
-				if (!st.desired && st.remote)
+			}
+			drainOutbound();
+			refreshSlotsIfRequested();
+
+			if (conn->context())
+			{
+				conn->tick(IO_POLL_INTERVAL);
+			}
+			else
+			{
+				conn->tick();
+				std::this_thread::sleep_for(IO_POLL_INTERVAL);
+			}
+			tickShards();
+			tickStreams();
+
+			connState = conn->state();
+
+			if (sharedError != conn->error())
+			{
+				std::lock_guard lock{ sharedMutex };
+				sharedError = conn->error();
+			}
+		}
+
+		// 共有メモリ: 送信キューを書き込み、届いているメッセージを最大 maxMessages 件読み込む
+		bool tickSharedMemory(size_t maxMessages)
+		{
+			drainOutbound();
+			return pollSharedMemory(maxMessages);
+		}
+
+		// 共有メモリから最大 maxMessages 件を読み込み、購読中のチャンネルとパターンへ渡す
+		bool pollSharedMemory(size_t maxMessages)
+		{
+			std::string_view channelName;
+			std::string_view payload;
+			size_t count = 0;
+			while (count < maxMessages && sharedMemory->next(channelName, payload))
+			{
+				++count;
+
+				// 自分が送ったものはローカル配送済み
+				if (stripOriginTag(payload))
 				{
-					unsubscribeCommand.push_back(key);
+					deliverLocal(channelName, payload);
 				}
 			}
 
-			// コマンド送信
-			auto sendCommand = [&, this](redisAsyncContext* context, redisCallbackFn* callback, const std::vector<std::string_view>& args) {
-				if (args.size() == 1) return;
-				const int argc = static_cast<int>(args.size());
-				std::vector<const char*> argv(argc);
-				std::vector<size_t> argvlen(argc);
-				for (size_t i = 0; i < args.size(); ++i)
+			if (const uint64 dropped = sharedMemory->dropped(); dropped != reportedDrops)
+			{
+				Logger << U"[MessageBus][ERROR] shared memory reader fell behind, dropped " << (dropped - reportedDrops) << U" message(s)";
+				reportedDrops = dropped;
+			}
+			return (count != 0);
+		}
+
+		// 受信イベントを tick() を呼ぶスレッドへ受け渡す（満杯なら残りは次のループで再試行）
+		void flushIoEvents()
+		{
+			size_t pushed = 0;
+			while (pushed < ioEventsBuf.size() &&
+				inboundQueue.tryPush(std::move(ioEventsBuf[pushed])))
+			{
+				++pushed;
+			}
+			ioEventsBuf.erase(ioEventsBuf.begin(), ioEventsBuf.begin() + pushed);
+		}
+
+		// tick() から呼ばれ、I/Oスレッドが受信したイベントを受け取る
+		void receiveFromIoThread(s3d::Duration budget = s3d::Duration::max())
+		{
+			// 時間の確認は数件ごとにまとめて行う
+			constexpr size_t BudgetCheckInterval = 64;
+
+			const Stopwatch sw{ StartImmediately::Yes };
+			InboundMessage message;
+			for (size_t popped = 0; eventOrder.size() < eventLimit; ++popped)
+			{
+				if ((popped % BudgetCheckInterval) == (BudgetCheckInterval - 1) && budget <= sw.elapsed())
 				{
-					argv[i] = args[i].data();
-					argvlen[i] = args[i].size();
+					break;
 				}
-				redisAsyncCommandArgv(context, callback, this, argc, argv.data(), argvlen.data());
-				};
-			sendCommand(context, reinterpret_cast<redisCallbackFn*>(Impl::onSubscriptionMessageReceive), subscribeCommand);
-			sendCommand(context, nullptr, unsubscribeCommand); // 失敗しても購読していないイベントはフィルターできるため無視
 
-			// 状態を最新の状態に更新
-			for (auto& [key, st] : channels)
+				if (not inboundQueue.tryPop(message))
+				{
+					break;
+				}
+				appendEvent(message.channel, message.pattern, message.payload, message.channelName);
+			}
+
+			// ハブに接続している場合はハブの接続のエラーを見る
+			auto& source = publisher();
+			std::lock_guard lock{ source.sharedMutex };
+			if (errorSnapshot != source.sharedError)
+			{
+				errorSnapshot = source.sharedError;
+			}
+		}
+
+		// 送信キューを hiredis に流す（非スレッドモードでは tick()、スレッドモードではI/Oスレッドから呼ばれる）
+		void drainOutbound()
+		{
+			const bool connected = sharedMemory
+				? sharedMemory->isOpen()
+				: (conn->state() == RedisConnectionState::Connected);
+
+			syncEmitOptions();
+			const double now = outboundClock.sF();
+
+			OutboundEvent event;
+			while (outboundQueue.tryPop(event))
+			{
+				// 切断中に積まれたイベントは破棄する
+				if (not connected)
+				{
+					++publishCounters.dropped;
+					continue;
+				}
+
+				// 送信オプションが無いチャンネルはそのまま送る
+				OutboundChannel* state = nullptr;
+				if (not outboundChannels.empty())
+				{
+					if (auto it = outboundChannels.find(event.channel); it != outboundChannels.end())
+					{
+						state = &it->second;
+					}
+				}
+
+				if (state)
+				{
+					if (state->options.coalesce)
+					{
+						// 未送信の値を上書きする（送信はフレームの区切りで行う）
+						if (state->hasPending)
+						{
+							++publishCounters.coalesced;
+						}
+						else
+						{
+							state->hasPending = true;
+							pendingChannels.push_back(state);
+						}
+						state->pending = std::move(event.payload);
+						continue;
+					}
+
+					if (not state->tryTakeToken(now))
+					{
+						++publishCounters.rateLimited;
+						continue;
+					}
+				}
+
+				sendPublish(event.channel, event.payload);
+			}
+
+			if (not connected)
+			{
+				dropPendingEmits();
+			}
+			else if (flushedFrame != frameCount.load(std::memory_order_acquire))
+			{
+				// 非スレッドモードでは毎回、スレッドモードでは tick() が呼ばれた後にのみ送る
+				flushedFrame = frameCount.load(std::memory_order_acquire);
+				flushPendingEmits(now);
+			}
+
+			flushPublishBuffer();
+		}
+
+		void sendPublish(std::string_view u8channel, std::string_view payload)
+		{
+			// 実際に送るものと同じペイロードを自分の購読へ先に渡し、Redis へは送信元タグを付けて送る
+			if (localDelivery)
+			{
+				deliverLocal(u8channel, payload);
+				taggedPayload.assign(originTag);
+				taggedPayload.append(payload);
+				payload = taggedPayload;
+			}
+
+			if (sharedMemory)
+			{
+				switch (sharedMemory->write(u8channel, payload))
+				{
+				case SharedMemoryRing::WriteResult::Written:
+					++publishCounters.sent;
+					++publishCounters.replied;
+					break;
+				case SharedMemoryRing::WriteResult::Dropped:
+					++publishCounters.dropped;
+					break;
+				default:
+					++publishCounters.errors;
+					break;
+				}
+				return;
+			}
+
+			// クラスタモードではスロットを持つシャードへ直接送る（スロット取得前は PUBLISH で全体に送る）
+			if (cluster && shardPublish(u8channel, payload))
+			{
+				return;
+			}
+
+			// ストリームチャンネルは XADD で追記する
+			if (not outboundStreams.empty())
+			{
+				if (auto it = outboundStreams.find(u8channel); it != outboundStreams.end())
+				{
+					streamAdd(u8channel, payload, it->second);
+					return;
+				}
+			}
+
+			if (batchedPublish)
+			{
+				appendPublishCommand(u8channel, payload);
+			}
+			else
+			{
+				publish(u8channel, payload);
+			}
+		}
+
+		// 保留中の coalesce の値を送る（レート制限に掛かったものは次のフレームへ持ち越す）
+		void flushPendingEmits(double now)
+		{
+			pendingChannels.remove_if([&](OutboundChannel* state)
+				{
+					if (not state->tryTakeToken(now))
+					{
+						return false;
+					}
+					sendPublish(state->channel, state->pending);
+					state->hasPending = false;
+					return true;
+				});
+		}
+
+		void dropPendingEmits()
+		{
+			publishCounters.dropped += pendingChannels.size();
+			for (auto* state : pendingChannels)
+			{
+				state->hasPending = false;
+				state->pending.clear();
+			}
+			pendingChannels.clear();
+		}
+
+		// setEmitOptions() の変更を送信側の状態に反映する
+		void syncEmitOptions()
+		{
+			const uint64 version = emitOptionsVersion.load(std::memory_order_acquire);
+			if (outboundOptionsVersion == version)
+			{
+				return;
+			}
+
+			{
+				std::lock_guard lock{ emitOptionsMutex };
+				for (const auto& [channel, options] : emitOptions)
+				{
+					auto [it, inserted] = outboundChannels.try_emplace(channel);
+					OutboundChannel& state = it->second;
+					if (inserted)
+					{
+						state.channel = channel;
+						state.tokens = Max(options.burst, 1.0);
+						state.lastRefill = outboundClock.sF();
+					}
+					state.options = options;
+				}
+				outboundStreams = streamOptions;
+			}
+			outboundOptionsVersion = version;
+
+			// 挿入で要素が移動し得るため、保留中の一覧を作り直す
+			pendingChannels.clear();
+			for (auto& [channel, state] : outboundChannels)
+			{
+				if (state.hasPending)
+				{
+					if (state.options.coalesce)
+					{
+						pendingChannels.push_back(&state);
+					}
+					else
+					{
+						// coalesce が解除された場合はそのまま送る
+						state.hasPending = false;
+						sendPublish(state.channel, state.pending);
+					}
+				}
+			}
+		}
+
+		void setEmitOptions(StringView channel, const EmitOptions& options)
+		{
+			if (not ValidateChannelName(channel))
+			{
+				return;
+			}
+
+			{
+				std::lock_guard lock{ emitOptionsMutex };
+				emitOptions[Unicode::ToUTF8(channel)] = options;
+			}
+			emitOptionsVersion.fetch_add(1, std::memory_order_release);
+		}
+
+		// RESP 形式の PUBLISH コマンドを publishBuffer に追記する
+		void appendPublishCommand(std::string_view u8channel, std::string_view payload)
+		{
+			const auto appendBulk = [this](std::string_view bulk) {
+				char digits[24];
+				const auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), bulk.size());
+				publishBuffer += '$';
+				publishBuffer.append(digits, end);
+				publishBuffer += "\r\n";
+				publishBuffer += bulk;
+				publishBuffer += "\r\n";
+			};
+
+			publishOffsets.push_back(publishBuffer.size());
+			publishBuffer += "*3\r\n$7\r\nPUBLISH\r\n";
+			appendBulk(u8channel);
+			appendBulk(payload);
+		}
+
+		// 1フレーム分の PUBLISH をまとめて hiredis の送信バッファへ積む
+		void flushPublishBuffer()
+		{
+			if (publishOffsets.isEmpty())
+			{
+				return;
+			}
+
+			auto* context = conn->context();
+			if (context)
+			{
+				redisCallbackFn* callback;
+				void* privdata;
+				PublishBatch* batch = nullptr;
+				if (deliveryMode == DeliveryMode::FireAndForget)
+				{
+					// 応答は件数を数えるだけ
+					callback = reinterpret_cast<redisCallbackFn*>(Impl::onPublishCountCallback);
+					privdata = &publishCounters;
+				}
+				else
+				{
+					// 応答はバッチ単位で1つのハンドラに集約する（最後の応答で解放）
+					batch = new PublishBatch{ .pending = publishOffsets.size(), .counters = &publishCounters };
+					callback = reinterpret_cast<redisCallbackFn*>(Impl::onPublishBatchCallback);
+					privdata = batch;
+				}
+
+				publishOffsets.push_back(publishBuffer.size());
+				for (size_t i = 0; i + 1 < publishOffsets.size(); ++i)
+				{
+					const size_t begin = publishOffsets[i];
+					const size_t length = publishOffsets[i + 1] - begin;
+
+					// 書式化済みのコマンドを追記するだけなので、ソケットへの書き込みは次の poll でまとめて1回になる
+					const int rc = redisAsyncFormattedCommand(
+						context,
+						callback,
+						privdata,
+						publishBuffer.data() + begin,
+						length
+					);
+					if (rc != REDIS_OK)
+					{
+						// 以降のコマンドは積まれないため、その分の応答待ちを取り消す
+						if (batch)
+						{
+							batch->pending -= (publishOffsets.size() - 1 - i);
+							if (batch->pending == 0)
+							{
+								delete batch;
+							}
+						}
+						break;
+					}
+					++publishCounters.sent;
+				}
+			}
+
+			publishBuffer.clear();
+			publishOffsets.clear();
+		}
+
+		bool isChannelsDirty() const
+		{
+			std::lock_guard lock{ channelsMutex };
+			return channelsDirty;
+		}
+
+		static void onSubscriptionMessageReceive(redisAsyncContext*, redisReply* reply, Impl* self)
+		{
+			// 事前条件チェック
+			if (!reply || reply->type != REDIS_REPLY_PUSH || reply->elements < 3) return;
+
+			// シャードの移動などでサーバー側から購読が解除された場合は、スロットを取り直して購読し直す
+			if (reply->element[0] &&
+				reply->element[0]->type == REDIS_REPLY_STRING &&
+				std::string_view{ reply->element[0]->str, reply->element[0]->len } == "sunsubscribe")
+			{
+				if (reply->element[1] && reply->element[1]->type == REDIS_REPLY_STRING)
+				{
+					self->onShardUnsubscribed(std::string_view{ reply->element[1]->str, reply->element[1]->len });
+				}
+				return;
+			}
+
+			// 型チェック
+			for (size_t i = 0; i < reply->elements; ++i)
+			{
+				if (!reply->element[i] || reply->element[i]->type != REDIS_REPLY_STRING)
+				{
+					return;
+				}
+			}
+
+			const auto str = [reply](size_t i) { return std::string_view{ reply->element[i]->str, reply->element[i]->len }; };
+			const std::string_view kind = str(0);
+
+			// メッセージのみ処理（["message" | "smessage", channel, payload] / ["pmessage", pattern, channel, payload]）
+			size_t payloadIndex;
+			if ((kind == "message" || kind == "smessage") && reply->elements == 3)
+			{
+				payloadIndex = 2;
+			}
+			else if (kind == "pmessage" && reply->elements == 4)
+			{
+				payloadIndex = 3;
+			}
+			else
+			{
+				return;
+			}
+
+			// リーダーで直接デコード済みのものは onMessage() で処理済み
+			if (IsDecodedPayload(reply->element[payloadIndex]))
+			{
+				return;
+			}
+
+			if (payloadIndex == 2)
+			{
+				self->onMessage({}, str(1), str(2));
+			}
+			else
+			{
+				self->onMessage(str(1), str(2), str(3));
+			}
+		}
+
+		// 購読メッセージ1件を受信バッファに追加する（I/O を行うスレッドから呼ばれる）
+		// glob はパターン購読（pmessage）の場合のみ空でない
+		void onMessage(std::string_view glob, std::string_view channelName, std::string_view payload)
+		{
+			// 接続を持つ側で送信元タグを取り除く（自分が送ったものはローカル配送済みのため破棄する）
+			if (conn && not stripOriginTag(payload))
+			{
+				return;
+			}
+
+			// ハブは1回受信したメッセージを、接続している MessageBus がそれぞれの購読で振り分ける
+			if (isHub)
+			{
+				fanOut(glob, channelName, payload);
+				return;
+			}
+
+			ChannelId channel;
+			matchedPatterns.clear();
+			{
+				std::lock_guard lock{ channelsMutex };
+
+				if (glob.empty())
+				{
+					// 購読中のチャンネルのみ処理
+					auto channelItr = channels.find(channelName);
+					if (channelItr == channels.end() ||
+						!channelItr->second.desired)
+					{
+						return;
+					}
+					channel = ChannelId{ channelItr->second.info.get() };
+				}
+				else
+				{
+					// glob は '/' を区別しないため、ローカルのパターンで照合し直す
+					// 同じ glob になるパターンは1つの PSUBSCRIBE にまとめているので、glob が一致するもの全てに配送する
+					compilePatternTrie();
+					patternTrie.match(channelName, [&](uint32 id)
+						{
+							if (compiledPatterns[id].glob == glob)
+							{
+								matchedPatterns.push_back(compiledPatterns[id].pattern);
+							}
+						});
+
+					if (matchedPatterns.isEmpty())
+					{
+						return;
+					}
+
+					// パターンのみで受信したチャンネルはインターンしない（無効な場合は tick() で名前から作る）
+					channel = findInterned(channelName);
+				}
+			}
+
+			// イベントバッファに追加（JSON のパースは Event::value() の初回呼び出しまで遅延する）
+			if (matchedPatterns.isEmpty())
+			{
+				deliverMessage(channel, ChannelId{}, payload);
+			}
+			for (const auto& pattern : matchedPatterns)
+			{
+				deliverMessage(channel, pattern, payload, channelName);
+			}
+		}
+
+		// 送信元タグがあれば取り除く（自分が付けたタグの場合は false）
+		// タグを付け合うのは localDelivery を有効にした MessageBus 同士のため、無効な場合は他のクライアントのペイロードに触れない
+		bool stripOriginTag(std::string_view& payload) const noexcept
+		{
+			if (not localDelivery ||
+				payload.size() < ORIGIN_TAG_SIZE ||
+				static_cast<uint8>(payload.front()) != ORIGIN_TAG_MARKER)
+			{
+				return true;
+			}
+
+			const bool own = payload.starts_with(originTag);
+			payload.remove_prefix(ORIGIN_TAG_SIZE);
+			return not own;
+		}
+
+		// 送信したメッセージを、Redis を経由せずに購読中のチャンネルとパターンへ渡す（drainOutbound() を呼ぶスレッドから呼ばれる）
+		void deliverLocal(std::string_view channelName, std::string_view payload)
+		{
+			if (isHub)
+			{
+				std::lock_guard lock{ frontEndsMutex };
+				for (auto* frontEnd : frontEnds)
+				{
+					frontEnd->deliverLocal(channelName, payload);
+				}
+				return;
+			}
+
+			ChannelId channel;
+			bool subscribed = false;
+			matchedPatterns.clear();
+			{
+				std::lock_guard lock{ channelsMutex };
+
+				if (auto channelItr = channels.find(channelName);
+					channelItr != channels.end() && channelItr->second.desired)
+				{
+					channel = ChannelId{ channelItr->second.info.get() };
+					subscribed = true;
+				}
+
+				// Redis と同様に、チャンネルとパターンの両方で購読していればそれぞれに配送する
+				compilePatternTrie();
+				patternTrie.match(channelName, [&](uint32 id)
+					{
+						matchedPatterns.push_back(compiledPatterns[id].pattern);
+					});
+
+				if (not subscribed)
+				{
+					if (matchedPatterns.isEmpty())
+					{
+						return;
+					}
+					channel = findInterned(channelName);
+				}
+			}
+
+			if (subscribed)
+			{
+				deliverMessage(channel, ChannelId{}, payload);
+			}
+			for (const auto& pattern : matchedPatterns)
+			{
+				deliverMessage(channel, pattern, payload, channelName);
+			}
+		}
+
+		// ハブ: 接続している全ての MessageBus に配送する（I/Oスレッドから呼ばれる）
+		void fanOut(std::string_view glob, std::string_view channelName, std::string_view payload)
+		{
+			std::lock_guard lock{ frontEndsMutex };
+			for (auto* frontEnd : frontEnds)
+			{
+				frontEnd->onMessage(glob, channelName, payload);
+			}
+		}
+
+		// ハブ: MessageBus が購読したチャンネル/パターンの参照を増やす（最初の参照で購読する）
+		void retainShared(const std::string& u8name, bool isPattern)
+		{
+			std::lock_guard lock{ refsMutex };
+			if ((isPattern ? patternRefs : channelRefs)[u8name]++ != 0)
+			{
+				return;
+			}
+
+			if (isPattern)
+			{
+				psubscribe(Unicode::FromUTF8(u8name));
+			}
+			else
+			{
+				subscribe(Unicode::FromUTF8(u8name));
+			}
+		}
+
+		// ハブ: 参照を減らす（最後の参照で購読を解除する）
+		void releaseShared(const std::string& u8name, bool isPattern)
+		{
+			std::lock_guard lock{ refsMutex };
+			auto& refs = isPattern ? patternRefs : channelRefs;
+			auto it = refs.find(u8name);
+			if (it == refs.end() || --it->second != 0)
+			{
+				return;
+			}
+			refs.erase(it);
+
+			if (isPattern)
+			{
+				punsubscribe(u8name);
+			}
+			else
+			{
+				unsubscribe(std::string_view{ u8name });
+			}
+		}
+
+		// ハブに接続した MessageBus: 購読の差分をハブの参照に反映する（tick() から呼ばれる）
+		void reconcileWithHub()
+		{
+			s3d::Array<std::pair<std::string, bool>> retains;
+			s3d::Array<std::pair<std::string, bool>> releases;
+			{
+				std::lock_guard lock{ channelsMutex };
+				if (not channelsDirty)
+				{
+					return;
+				}
+
+				for (auto* table : { &channels, &patterns })
+				{
+					const bool isPattern = (table == &patterns);
+					for (auto& [key, st] : *table)
+					{
+						if (st.desired != st.remote)
+						{
+							(st.desired ? retains : releases).emplace_back(key, isPattern);
+							st.remote = st.desired;
+						}
+					}
+				}
+				channelsDirty = false;
+			}
+
+			// ハブの channelsMutex を取るため、自分のロックを外してから呼ぶ
+			for (const auto& [name, isPattern] : retains)
+			{
+				hub->retainShared(name, isPattern);
+			}
+			for (const auto& [name, isPattern] : releases)
+			{
+				hub->releaseShared(name, isPattern);
+			}
+		}
+
+		// ハブに接続した MessageBus の tick() で、I/O の代わりに行う処理
+		void tickFrontEnd()
+		{
+			reconcileWithHub();
+			hub->onFrontEndTick(*this);
+			connState = hub->connState.load();
+		}
+
+		// ハブ: MessageBus の tick() をアプリケーションのフレームにまとめる
+		// coalesce の送信はI/Oスレッドが frameCount の変化で行うため、MessageBus の数によらず1フレームに1回だけ進める
+		void onFrontEndTick(Impl& frontEnd)
+		{
+			std::lock_guard lock{ frontEndsMutex };
+
+			// 同じフレームで2回目の tick() は次のフレームの始まり（tick() しない MessageBus があっても進むようにする）
+			if (frontEnd.tickedHubFrame == frontEndFrame)
+			{
+				advanceFrontEndFrame();
+			}
+			frontEnd.tickedHubFrame = frontEndFrame;
+
+			// 全ての MessageBus が tick() し終えたらフレームの終わり
+			if (std::all_of(frontEnds.begin(), frontEnds.end(), [this](const Impl* f) { return f->tickedHubFrame == frontEndFrame; }))
+			{
+				advanceFrontEndFrame();
+			}
+		}
+
+		void advanceFrontEndFrame()
+		{
+			++frontEndFrame;
+			frameCount.fetch_add(1, std::memory_order_release);
+		}
+
+		// channel が無効な場合は channelName でパターンのみのチャンネルとして渡す
+		void deliverMessage(ChannelId channel, ChannelId pattern, std::string_view payload, std::string_view channelName = {})
+		{
+			if (threaded)
+			{
+				ioEventsBuf.push_back(InboundMessage{ channel, pattern, std::string{ payload }, channel ? std::string{} : std::string{ channelName } });
+			}
+			else
+			{
+				pushEvent(channel, pattern, payload, channel ? std::string_view{} : channelName);
+			}
+		}
+
+		// 購読中のパターンから照合用の木を作り直す（channelsMutex を保持して呼ぶ）
+		void compilePatternTrie()
+		{
+			if (not patternTrieDirty)
+			{
+				return;
+			}
+
+			patternTrie.clear();
+			compiledPatterns.clear();
+			for (const auto& [key, st] : patterns)
+			{
+				if (st.desired)
+				{
+					patternTrie.insert(key, static_cast<uint32>(compiledPatterns.size()));
+					compiledPatterns.push_back(CompiledPattern{ ChannelId{ st.info.get() }, st.glob });
+				}
+			}
+			patternTrieDirty = false;
+		}
+
+		// インターン済みのチャンネル（channelsMutex を保持して呼ぶ。無い場合は無効なハンドル）
+		ChannelId findInterned(std::string_view u8channel) const
+		{
+			if (auto channelItr = channels.find(u8channel); channelItr != channels.end())
+			{
+				return ChannelId{ channelItr->second.info.get() };
+			}
+			return ChannelId{};
+		}
+
+		// チャンネル名をインターンする（channelsMutex を保持して呼ぶ。新規の場合は購読しない状態で登録する）
+		ChannelId internChannel(std::string_view u8channel)
+		{
+			if (auto channelItr = channels.find(u8channel); channelItr != channels.end())
+			{
+				return ChannelId{ channelItr->second.info.get() };
+			}
+
+			std::string key{ u8channel };
+			auto info = std::make_unique<ChannelInfo>(ChannelInfo{
+				.index = channelCount++,
+				.name = Unicode::FromUTF8(u8channel),
+				.utf8Name = key
+			});
+			const ChannelId id{ info.get() };
+			channels.emplace(std::move(key), ChannelState{ .info = std::move(info) });
+			return id;
+		}
+
+		// ハンドルに対応する状態（channelsMutex を保持して呼ぶ）
+		ChannelState& stateOf(ChannelId id)
+		{
+			auto& table = id.info()->isPattern ? patterns : channels;
+			return table.find(id.utf8Name())->second;
+		}
+
+		void markAllUnsubscribed()
+		{
+			std::lock_guard lock{ channelsMutex };
+
+			// クラスタモードのチャンネルはシャードの接続で購読しているため影響しない
+			if (not cluster)
+			{
+				for (auto& [key, st] : channels)
+				{
+					st.remote = false;
+				}
+			}
+			for (auto& [key, st] : patterns)
+			{
+				st.remote = false;
+			}
+			remoteGlobs.clear();
+			channelsDirty = true;
+		}
+
+		void reconcileSubscriptions(redisAsyncContext* context)
+		{
+			if (!context) return;
+
+			std::lock_guard lock{ channelsMutex };
+
+			if (cluster)
+			{
+				reconcileShardSubscriptions();
+			}
+			else
+			{
+				// コマンド構築
+				std::vector<std::string_view> subscribeCommand{ {"SUBSCRIBE"} };
+				std::vector<std::string_view> unsubscribeCommand{ {"UNSUBSCRIBE"} };
+				for (const auto& [key, st] : channels)
+				{
+					// ストリームチャンネルは XREAD で読み込むため SUBSCRIBE しない
+					const bool desired = st.desired && !st.stream;
+					if (desired && !st.remote)
+					{
+						subscribeCommand.push_back(key);
+					}
+					if (!desired && st.remote)
+					{
+						unsubscribeCommand.push_back(key);
+					}
+				}
+
+				// コマンド送信
+				sendCommand(context, reinterpret_cast<redisCallbackFn*>(Impl::onSubscriptionMessageReceive), subscribeCommand);
+				sendCommand(context, nullptr, unsubscribeCommand); // 失敗しても購読していないイベントはフィルターできるため無視
+
+				for (auto& [key, st] : channels)
+				{
+					st.remote = st.desired && !st.stream;
+				}
+			}
+
+			// パターンは glob 単位で PSUBSCRIBE する（同じ glob になるパターンは1つにまとめる）
+			s3d::Array<std::string> desiredGlobs;
+			for (const auto& [key, st] : patterns)
+			{
+				if (st.desired)
+				{
+					desiredGlobs.push_back(st.glob);
+				}
+			}
+			std::sort(desiredGlobs.begin(), desiredGlobs.end());
+			desiredGlobs.erase(std::unique(desiredGlobs.begin(), desiredGlobs.end()), desiredGlobs.end());
+
+			std::vector<std::string_view> psubscribeCommand{ {"PSUBSCRIBE"} };
+			std::vector<std::string_view> punsubscribeCommand{ {"PUNSUBSCRIBE"} };
+			std::set_difference(desiredGlobs.begin(), desiredGlobs.end(), remoteGlobs.begin(), remoteGlobs.end(), std::back_inserter(psubscribeCommand));
+			std::set_difference(remoteGlobs.begin(), remoteGlobs.end(), desiredGlobs.begin(), desiredGlobs.end(), std::back_inserter(punsubscribeCommand));
+			sendCommand(context, reinterpret_cast<redisCallbackFn*>(Impl::onSubscriptionMessageReceive), psubscribeCommand);
+			sendCommand(context, nullptr, punsubscribeCommand);
+
+			// 状態を最新の状態に更新
+			for (auto& [key, st] : patterns)
+			{
+				st.remote = st.desired;
+			}
+			remoteGlobs = std::move(desiredGlobs);
+			channelsDirty = false;
+		}
+
+		// args[0] をコマンド名とするコマンドを送る（引数が無い場合は送らない）
+		void sendCommand(redisAsyncContext* context, redisCallbackFn* callback, const std::vector<std::string_view>& args)
+		{
+			if (args.size() <= 1) return;
+			const int argc = static_cast<int>(args.size());
+			std::vector<const char*> argv(argc);
+			std::vector<size_t> argvlen(argc);
+			for (size_t i = 0; i < args.size(); ++i)
+			{
+				argv[i] = args[i].data();
+				argvlen[i] = args[i].size();
+			}
+			redisAsyncCommandArgv(context, callback, this, argc, argv.data(), argvlen.data());
+		}
+
+		// ================================
+		// クラスタモード
+		// ================================
+
+		// シード（制御用）接続の準備完了
+		void onControlReady(redisAsyncContext* context)
+		{
+			reconcileSubscriptions(context);
+
+			if (cluster)
+			{
+				slotRefreshRequested = true;
+				refreshSlotsIfRequested();
+			}
+		}
+
+		redisAsyncContext* shardContext(uint16 shard) const
+		{
+			if (shards.size() <= shard ||
+				shards[shard]->conn->state() != RedisConnectionState::Connected)
+			{
+				return nullptr;
+			}
+			return shards[shard]->conn->context();
+		}
+
+		void tickShards()
+		{
+			for (auto& shard : shards)
+			{
+				shard->conn->tick();
+			}
+		}
+
+		// close(): 制御用の接続に加え、シャードとストリームの接続も切断する（いずれも再接続しない）
+		void closeConnections()
+		{
+			closed = true;
+			conn->disconnect();
+			for (auto& shard : shards)
+			{
+				shard->conn->disconnect();
+			}
+			if (streamConn)
+			{
+				streamConn->disconnect();
+			}
+		}
+
+		// 全ての接続を1回ポーリングし、いずれかで受信データを処理した場合 true を返す
+		bool pollConnections()
+		{
+			bool received = conn->poll();
+			for (auto& shard : shards)
+			{
+				received |= shard->conn->poll();
+			}
+			if (streamConn)
+			{
+				received |= streamConn->poll();
+			}
+			return received;
+		}
+
+		void refreshSlotsIfRequested()
+		{
+			if (not cluster ||
+				not slotRefreshRequested ||
+				slotRefreshInFlight ||
+				conn->state() != RedisConnectionState::Connected)
+			{
+				return;
+			}
+
+			slotRefreshRequested = false;
+			slotRefreshInFlight = true;
+			redisAsyncCommand(conn->context(), reinterpret_cast<redisCallbackFn*>(Impl::onClusterSlots), this, "CLUSTER SLOTS");
+		}
+
+		// CLUSTER SLOTS の応答: [[start, end, [host, port, id, ...], レプリカ...], ...]
+		static void onClusterSlots(redisAsyncContext*, redisReply* reply, Impl* self)
+		{
+			if (!reply) return;
+			self->slotRefreshInFlight = false;
+
+			// close() 後に届いた応答でシャードの接続を作らない
+			if (self->closed)
+			{
+				return;
+			}
+
+			if (reply->type == REDIS_REPLY_ERROR)
+			{
+				Logger << U"[MessageBus][ERROR] CLUSTER SLOTS failed: " << Unicode::FromUTF8(std::string_view{ reply->str, reply->len });
+				return;
+			}
+			if (reply->type != REDIS_REPLY_ARRAY)
+			{
+				return;
+			}
+
+			self->slotOwners.fill(NoShard);
+			for (size_t i = 0; i < reply->elements; ++i)
+			{
+				const redisReply* range = reply->element[i];
+				if (range->type != REDIS_REPLY_ARRAY ||
+					range->elements < 3 ||
+					range->element[0]->type != REDIS_REPLY_INTEGER ||
+					range->element[1]->type != REDIS_REPLY_INTEGER ||
+					range->element[2]->type != REDIS_REPLY_ARRAY ||
+					range->element[2]->elements < 2)
+				{
+					continue;
+				}
+
+				const redisReply* master = range->element[2];
+				std::string_view host;
+				if (master->element[0]->type == REDIS_REPLY_STRING)
+				{
+					host = std::string_view{ master->element[0]->str, master->element[0]->len };
+				}
+				if (master->element[1]->type != REDIS_REPLY_INTEGER)
+				{
+					continue;
+				}
+
+				const uint16 shard = self->findOrAddShard(host, static_cast<uint16>(master->element[1]->integer));
+				const long long first = Max(range->element[0]->integer, 0LL);
+				const long long last = Min(range->element[1]->integer, static_cast<long long>(CLUSTER_SLOT_COUNT - 1));
+				for (long long slot = first; slot <= last; ++slot)
+				{
+					self->slotOwners[static_cast<size_t>(slot)] = shard;
+				}
+			}
+			self->slotMapReady = true;
+
+			// 持ち主が変わったスロットのチャンネルは購読し直す
+			std::lock_guard lock{ self->channelsMutex };
+			for (auto& [key, st] : self->channels)
+			{
+				if (st.remote && st.remoteShard != self->slotOwners[KeyHashSlot(key)])
+				{
+					if (auto* context = self->shardContext(st.remoteShard))
+					{
+						self->sendCommand(context, nullptr, { "SUNSUBSCRIBE", key });
+					}
+					st.remote = false;
+					st.remoteShard = NoShard;
+				}
+			}
+			self->channelsDirty = true;
+		}
+
+		// host が空または "?" の場合はシードノードと同じホストとみなす
+		uint16 findOrAddShard(std::string_view host, uint16 port)
+		{
+			const String hostName = (host.empty() || host == "?") ? conn->ip() : Unicode::FromUTF8(host);
+			for (size_t i = 0; i < shards.size(); ++i)
+			{
+				if (shards[i]->host == hostName && shards[i]->port == port)
+				{
+					return static_cast<uint16>(i);
+				}
+			}
+
+			const auto index = static_cast<uint16>(shards.size());
+			const Optional<String> password = conn->password();
+			Optional<StringView> passwordView;
+			if (password)
+			{
+				passwordView = *password;
+			}
+
+			auto shard = std::make_unique<Shard>();
+			shard->host = hostName;
+			shard->port = port;
+			shard->conn = std::make_unique<RedisConnection>(RedisConnectionOptions{
+				.ip = shard->host,
+				.port = port,
+				.password = passwordView,
+				.heartbeatInterval = s3d::Seconds{ 10 },
+				.onConnect = nullptr,
+				.onReady = [this](redisAsyncContext*) { std::lock_guard lock{ channelsMutex }; channelsDirty = true; },
+				.onDisconnect = [this, index]() { markShardUnsubscribed(index); },
+				.onMessage = [this](std::string_view pattern, std::string_view channel, std::string_view payload) { onMessage(pattern, channel, payload); }
+			});
+			shards.push_back(std::move(shard));
+			return index;
+		}
+
+		void markShardUnsubscribed(uint16 shard)
+		{
+			std::lock_guard lock{ channelsMutex };
+			for (auto& [key, st] : channels)
+			{
+				if (st.remoteShard == shard)
+				{
+					st.remote = false;
+					st.remoteShard = NoShard;
+				}
+			}
+			channelsDirty = true;
+		}
+
+		void onShardUnsubscribed(std::string_view u8channel)
+		{
+			std::lock_guard lock{ channelsMutex };
+			auto channelItr = channels.find(u8channel);
+			if (channelItr == channels.end() ||
+				not channelItr->second.desired ||
+				not channelItr->second.remote)
+			{
+				// 自分で解除したもの
+				return;
+			}
+
+			channelItr->second.remote = false;
+			channelItr->second.remoteShard = NoShard;
+			channelsDirty = true;
+			slotRefreshRequested = true;
+		}
+
+		// チャンネルをスロットを持つシャードで SSUBSCRIBE する（channelsMutex を保持して呼ぶ）
+		// 1つの SSUBSCRIBE には同じスロットのチャンネルしか指定できないため、スロットごとにまとめる
+		void reconcileShardSubscriptions()
+		{
+			if (not slotMapReady)
+			{
+				// CLUSTER SLOTS の応答後に改めて呼ばれる
+				return;
+			}
+
+			struct PendingSubscribe
+			{
+				uint16 shard;
+				uint16 slot;
+				std::string_view channel;
+				ChannelState* state;
+			};
+			s3d::Array<PendingSubscribe> pending;
+
+			for (auto& [key, st] : channels)
+			{
+				if (st.desired && !st.remote)
+				{
+					const uint16 slot = KeyHashSlot(key);
+					const uint16 shard = slotOwners[slot];
+					if (shardContext(shard))
+					{
+						pending.push_back(PendingSubscribe{ shard, slot, key, &st });
+					}
+				}
+				else if (!st.desired && st.remote)
+				{
+					if (auto* context = shardContext(st.remoteShard))
+					{
+						sendCommand(context, nullptr, { "SUNSUBSCRIBE", key });
+					}
+					st.remote = false;
+					st.remoteShard = NoShard;
+				}
+			}
+
+			std::sort(pending.begin(), pending.end(), [](const PendingSubscribe& a, const PendingSubscribe& b)
+				{
+					return (a.shard != b.shard) ? (a.shard < b.shard) : (a.slot < b.slot);
+				});
+
+			std::vector<std::string_view> command;
+			for (size_t i = 0; i < pending.size();)
+			{
+				command.assign({ "SSUBSCRIBE" });
+				size_t j = i;
+				for (; j < pending.size() && pending[j].shard == pending[i].shard && pending[j].slot == pending[i].slot; ++j)
+				{
+					command.push_back(pending[j].channel);
+					pending[j].state->remote = true;
+					pending[j].state->remoteShard = pending[j].shard;
+				}
+				sendCommand(shardContext(pending[i].shard), reinterpret_cast<redisCallbackFn*>(Impl::onSubscriptionMessageReceive), command);
+				i = j;
+			}
+		}
+
+		// SPUBLISH をスロットを持つシャードへ送る。スロットが未取得の場合は false
+		bool shardPublish(std::string_view u8channel, std::string_view payload)
+		{
+			if (not slotMapReady)
+			{
+				return false;
+			}
+
+			const uint16 shard = slotOwners[KeyHashSlot(u8channel)];
+			auto* context = shardContext(shard);
+			if (!context)
+			{
+				// シャードへ接続中。emit は破棄してエラーとして数える
+				++publishCounters.errors;
+				return true;
+			}
+
+			const char* argv[3] = { "SPUBLISH", u8channel.data(), payload.data() };
+			const size_t argvlen[3] = { 8, u8channel.size(), payload.size() };
+			if (redisAsyncCommandArgv(context, reinterpret_cast<redisCallbackFn*>(Impl::onShardPublishCallback), this, 3, argv, argvlen) == REDIS_OK)
+			{
+				++publishCounters.sent;
+			}
+			return true;
+		}
+
+		static void onShardPublishCallback(redisAsyncContext* context, redisReply* reply, Impl* self)
+		{
+			if (!reply) return;
+
+			onPublishCountCallback(context, reply, &self->publishCounters);
+
+			// スロットが移動している場合は取り直す
+			if (reply->type == REDIS_REPLY_ERROR)
+			{
+				const std::string_view error{ reply->str, reply->len };
+				if (error.starts_with("MOVED") || error.starts_with("ASK"))
+				{
+					self->slotRefreshRequested = true;
+				}
+			}
+		}
+
+		// ================================
+		// ストリームチャンネル
+		// ================================
+
+		ChannelId declareStream(StringView channel, const StreamOptions& options)
+		{
+			if (not ValidateChannelName(channel) || cluster || sharedMemory)
+			{
+				return ChannelId{};
+			}
+
+			auto u8channel = Unicode::ToUTF8(channel);
+
+			ChannelId id;
+			{
+				std::lock_guard lock{ channelsMutex };
+				id = internChannel(u8channel);
+				auto& state = stateOf(id);
+				if (not state.stream)
+				{
+					// SUBSCRIBE 済みの場合は解除して XREAD に切り替える
+					state.stream = true;
+					channelsDirty = true;
+				}
+			}
+
+			{
+				std::lock_guard lock{ emitOptionsMutex };
+				streamOptions[std::move(u8channel)] = options;
+			}
+			emitOptionsVersion.fetch_add(1, std::memory_order_release);
+			streamsDeclared.store(true, std::memory_order_release);
+			return id;
+		}
+
+		// XADD key [MAXLEN ~ n] * payload <payload>
+		void streamAdd(std::string_view u8channel, std::string_view payload, const StreamOptions& options)
+		{
+			auto* context = conn->context();
+			if (!context)
+			{
+				return;
+			}
+
+			char maxLength[24];
+			const auto [end, ec] = std::to_chars(std::begin(maxLength), std::end(maxLength), options.maxLength);
+
+			std::vector<std::string_view> args{ "XADD", u8channel };
+			if (options.maxLength != 0)
+			{
+				args.insert(args.end(), { "MAXLEN", "~", std::string_view{ maxLength, static_cast<size_t>(end - maxLength) } });
+			}
+			args.insert(args.end(), { "*", "payload", payload });
+
+			std::vector<const char*> argv(args.size());
+			std::vector<size_t> argvlen(args.size());
+			for (size_t i = 0; i < args.size(); ++i)
+			{
+				argv[i] = args[i].data();
+				argvlen[i] = args[i].size();
+			}
+
+			// 応答はエントリIDなので、件数とエラーのみ集計する
+			if (redisAsyncCommandArgv(context, reinterpret_cast<redisCallbackFn*>(Impl::onPublishCountCallback), &publishCounters,
+				static_cast<int>(args.size()), argv.data(), argvlen.data()) == REDIS_OK)
+			{
+				++publishCounters.sent;
+			}
+		}
+
+		// 読み込み用の接続を維持し、前回の XREAD が返ってきていれば次を送る
+		void tickStreams()
+		{
+			if (not streamConn)
+			{
+				// close() 後は読み込み用の接続を新たに作らない
+				if (closed || not streamsDeclared.load(std::memory_order_acquire))
+				{
+					return;
+				}
+
+				const Optional<String> password = conn->password();
+				Optional<StringView> passwordView;
+				if (password)
+				{
+					passwordView = *password;
+				}
+
+				// 制御用の接続と同じ経路（Unix ドメインソケットを含む）で接続する
+				Optional<StringView> unixSocketView;
+				if (conn->unixSocket())
+				{
+					unixSocketView = *conn->unixSocket();
+				}
+
+				streamConn = std::make_unique<RedisConnection>(RedisConnectionOptions{
+					.ip = conn->ip(),
+					.port = conn->port(),
+					.password = passwordView,
+					.unixSocket = unixSocketView,
+					.heartbeatInterval = s3d::Seconds{ 10 },
+					.onConnect = nullptr,
+					.onReady = nullptr,
+					.onDisconnect = [this]() { onStreamDisconnect(); }
+				});
+			}
+
+			if (streamConn->state() == RedisConnectionState::Connected &&
+				not streamReadInFlight &&
+				streamReadResumeAt <= outboundClock.sF())
+			{
+				requestStreamRead();
+			}
+
+			streamConn->tick();
+		}
+
+		void onStreamDisconnect()
+		{
+			// 未応答の読み込みは破棄されるため、再接続後に保持している位置から読み直す
+			streamReadInFlight = false;
+
+			std::lock_guard lock{ channelsMutex };
+			for (auto& [key, st] : channels)
+			{
+				st.lastIdPending = false;
+			}
+		}
+
+		// XREAD COUNT n BLOCK ms STREAMS key... id...
+		void requestStreamRead()
+		{
+			auto* context = streamConn->context();
+
+			char count[24];
+			const auto [countEnd, countEc] = std::to_chars(std::begin(count), std::end(count), streamReadCount);
+			char block[24];
+			const auto [blockEnd, blockEc] = std::to_chars(std::begin(block), std::end(block), static_cast<int64>(STREAM_BLOCK_TIMEOUT.count() * 1000));
+
+			std::vector<std::string_view> args{
+				"XREAD",
+				"COUNT", std::string_view{ count, static_cast<size_t>(countEnd - count) },
+				"BLOCK", std::string_view{ block, static_cast<size_t>(blockEnd - block) },
+				"STREAMS"
+			};
+
+			std::lock_guard lock{ channelsMutex };
+
+			s3d::Array<std::string_view> ids;
+			for (auto& [key, st] : channels)
+			{
+				if (not st.stream)
+				{
+					continue;
+				}
+
+				if (not st.desired)
+				{
+					// 購読し直した場合は、その時点から読み込む
+					st.lastId.clear();
+					continue;
+				}
+
+				if (st.lastId.empty())
+				{
+					// 最初の読み込みの前に現在の末尾のIDを取得する（"$" は XREAD ごとに解決されるため、空振りの間に追加されたエントリを取りこぼす）
+					if (not st.lastIdPending)
+					{
+						st.lastIdPending = true;
+						auto* request = new StreamTailRequest{ .self = this, .key = key };
+						redisAsyncCommand(context, reinterpret_cast<redisCallbackFn*>(Impl::onStreamTail), request,
+							"XREVRANGE %b + - COUNT 1", key.data(), key.size());
+					}
+					continue;
+				}
+
+				args.push_back(key);
+				ids.push_back(st.lastId);
+			}
+
+			if (ids.isEmpty())
+			{
+				return;
+			}
+			args.insert(args.end(), ids.begin(), ids.end());
+
+			sendCommand(context, reinterpret_cast<redisCallbackFn*>(Impl::onStreamRead), args);
+			streamReadInFlight = true;
+		}
+
+		struct StreamTailRequest
+		{
+			Impl* self;
+			std::string key;
+		};
+
+		static void onStreamTail(redisAsyncContext*, redisReply* reply, StreamTailRequest* request)
+		{
+			std::unique_ptr<StreamTailRequest> owner{ request };
+
+			// 切断時は reply が nullptr で呼ばれる（Impl の破棄中の可能性があるため触れない）
+			if (!reply) return;
+
+			Impl* self = request->self;
+			if (reply->type == REDIS_REPLY_ERROR)
+			{
+				// ストリーム以外の型のキーなど。lastIdPending を立てたままにし、読み込みに含めない
+				Logger << U"[MessageBus][ERROR] XREVRANGE failed: " << Unicode::FromUTF8(request->key)
+					<< U", " << Unicode::FromUTF8(std::string_view{ reply->str, reply->len });
+				return;
+			}
+
+			// 空（またはキーが無い）の場合は先頭から読む
+			std::string lastId = "0-0";
+			if (reply->type == REDIS_REPLY_ARRAY &&
+				reply->elements != 0 &&
+				reply->element[0]->type == REDIS_REPLY_ARRAY &&
+				reply->element[0]->elements != 0 &&
+				reply->element[0]->element[0]->type == REDIS_REPLY_STRING)
+			{
+				lastId.assign(reply->element[0]->element[0]->str, reply->element[0]->element[0]->len);
+			}
+
+			std::lock_guard lock{ self->channelsMutex };
+			if (auto channelItr = self->channels.find(request->key); channelItr != self->channels.end())
+			{
+				channelItr->second.lastIdPending = false;
+				if (channelItr->second.desired)
+				{
+					channelItr->second.lastId = std::move(lastId);
+				}
+			}
+		}
+
+		// XREAD の応答: RESP3 では { key: [[id, [field, value, ...]], ...], ... }、RESP2 では [[key, entries], ...]
+		static void onStreamRead(redisAsyncContext*, redisReply* reply, Impl* self)
+		{
+			if (!reply) return;
+			self->streamReadInFlight = false;
+
+			if (reply->type == REDIS_REPLY_ERROR)
+			{
+				Logger << U"[MessageBus][ERROR] XREAD failed: " << Unicode::FromUTF8(std::string_view{ reply->str, reply->len });
+				self->streamReadResumeAt = self->outboundClock.sF() + STREAM_RETRY_INTERVAL.count();
+				return;
+			}
+
+			// タイムアウト
+			if (reply->type == REDIS_REPLY_NIL)
+			{
+				return;
+			}
+
+			if (reply->type == REDIS_REPLY_MAP)
+			{
+				for (size_t i = 0; i + 1 < reply->elements; i += 2)
+				{
+					self->onStreamEntries(reply->element[i], reply->element[i + 1]);
+				}
+			}
+			else if (reply->type == REDIS_REPLY_ARRAY)
+			{
+				for (size_t i = 0; i < reply->elements; ++i)
+				{
+					const redisReply* stream = reply->element[i];
+					if (stream->type == REDIS_REPLY_ARRAY && stream->elements == 2)
+					{
+						self->onStreamEntries(stream->element[0], stream->element[1]);
+					}
+				}
+			}
+		}
+
+		// 1つのストリームから読み込んだエントリを受信バッファに追加する
+		void onStreamEntries(const redisReply* key, const redisReply* entries)
+		{
+			if (key->type != REDIS_REPLY_STRING ||
+				entries->type != REDIS_REPLY_ARRAY ||
+				entries->elements == 0)
+			{
+				return;
+			}
+
+			const std::string_view u8channel{ key->str, key->len };
+
+			ChannelId channel;
+			{
+				std::lock_guard lock{ channelsMutex };
+				auto channelItr = channels.find(u8channel);
+				if (channelItr == channels.end() ||
+					not channelItr->second.desired ||
+					not channelItr->second.stream)
+				{
+					return;
+				}
+
+				// 次の XREAD はこのバッチの最後のエントリの次から読む
+				const redisReply* last = entries->element[entries->elements - 1];
+				if (last->type == REDIS_REPLY_ARRAY && last->elements != 0 && last->element[0]->type == REDIS_REPLY_STRING)
+				{
+					channelItr->second.lastId.assign(last->element[0]->str, last->element[0]->len);
+				}
+				channel = ChannelId{ channelItr->second.info.get() };
+			}
+
+			for (size_t i = 0; i < entries->elements; ++i)
+			{
+				const redisReply* entry = entries->element[i];
+				if (entry->type != REDIS_REPLY_ARRAY ||
+					entry->elements < 2 ||
+					entry->element[1]->type != REDIS_REPLY_ARRAY)
+				{
+					continue;
+				}
+
+				// emit() が書き込む "payload" フィールドを取り出す（無い場合は空のペイロード）
+				const redisReply* fields = entry->element[1];
+				std::string_view payload;
+				for (size_t f = 0; f + 1 < fields->elements; f += 2)
+				{
+					if (fields->element[f]->type == REDIS_REPLY_STRING &&
+						std::string_view{ fields->element[f]->str, fields->element[f]->len } == "payload")
+					{
+						payload = std::string_view{ fields->element[f + 1]->str, fields->element[f + 1]->len };
+						break;
+					}
+				}
+
+				if (not stripOriginTag(payload))
+				{
+					continue;
+				}
+
+				if (isHub)
+				{
+					fanOut({}, u8channel, payload);
+				}
+				else
+				{
+					deliverMessage(channel, ChannelId{}, payload);
+				}
+			}
+		}
+
+		struct PublishBatch
+		{
+			size_t pending = 0;
+			size_t count = 0;
+			long long delivered = 0;
+			size_t errors = 0;
+			std::string lastError;
+			PublishCounters* counters = nullptr;
+		};
+
+		static void onPublishBatchCallback(redisAsyncContext*, redisReply* reply, PublishBatch* batch)
+		{
+			if (reply)
+			{
+				CountPublishReply(*batch->counters, reply);
+
+				++batch->count;
+				if (reply->type == REDIS_REPLY_INTEGER)
+				{
+					batch->delivered += reply->integer;
+				}
+				else if (reply->type == REDIS_REPLY_ERROR)
+				{
+					++batch->errors;
+					batch->lastError.assign(reply->str, reply->len);
+				}
+			}
+
+			if (--batch->pending != 0)
+			{
+				return;
+			}
+
+			// バッチの最後の応答でまとめてログを出す（切断時は reply が nullptr で呼ばれる）
+			if (batch->count != 0)
+			{
+				Logger << U"[MessageBus][INFO] PUBLISH batch count=" << batch->count << U", delivered=" << batch->delivered;
+			}
+			if (batch->errors != 0)
+			{
+				Logger << U"[MessageBus][ERROR] PUBLISH failed: " << batch->errors << U" error(s), last: " << Unicode::FromUTF8(batch->lastError);
+			}
+			delete batch;
+		}
+
+		static void CountPublishReply(PublishCounters& counters, const redisReply* reply)
+		{
+			++counters.replied;
+			if (reply->type == REDIS_REPLY_INTEGER)
+			{
+				counters.delivered += static_cast<uint64>(reply->integer);
+			}
+			else if (reply->type == REDIS_REPLY_ERROR)
+			{
+				++counters.errors;
+			}
+		}
+
+		// FireAndForget 用: ログは出さず件数のみ集計し、エラーは1秒に1回だけまとめて出す
+		static void onPublishCountCallback(redisAsyncContext*, redisReply* reply, PublishCounters* counters)
+		{
+			// 切断時は reply が nullptr で呼ばれる（Impl の破棄中の可能性があるため counters に触れない）
+			if (!reply) return;
+
+			CountPublishReply(*counters, reply);
+
+			if (reply->type != REDIS_REPLY_ERROR)
+			{
+				return;
+			}
+
+			++counters->errorsSinceLastLog;
+			if (counters->errorLogTimer.isRunning() &&
+				counters->errorLogTimer.elapsed() < PUBLISH_ERROR_LOG_INTERVAL)
 			{
-				st.remote = st.desired;
+				return;
 			}
-			channelsDirty = false;
+
+			Logger << U"[MessageBus][ERROR] PUBLISH failed: " << counters->errorsSinceLastLog
+				<< U" error(s) since last report, last: " << Unicode::FromUTF8(std::string_view{ reply->str, reply->len });
+			counters->errorsSinceLastLog = 0;
+			counters->errorLogTimer.restart();
 		}
 
 		static void onPublishCallback(redisAsyncContext*, redisReply* reply, Impl*)
@@ -159,77 +2342,307 @@ namespace MessageBus
 			}
 		}
 
-		bool emit(StringView channel, Optional<JSON> payload)
+		bool emit(StringView channel, const Optional<JSON>& payload)
 		{
 			if (not ValidateChannelName(channel) ||
-				conn.state() != RedisConnectionState::Connected)
+				connState != RedisConnectionState::Connected)
 			{
 				return false;
 			}
 
-			auto* context = conn.context();
-			if (!context)
+			std::string encoded;
+			if (payload.has_value())
+			{
+				PayloadCodec::Encode(*payload, payloadFormat, encoded);
+			}
+			return emitPayload(channel, std::move(encoded));
+		}
+
+		// 書式化済みのペイロードを送信キューに積む
+		bool emitPayload(StringView channel, std::string&& payload)
+		{
+			if (not ValidateChannelName(channel))
+			{
+				return false;
+			}
+
+			return enqueueEmit(Unicode::ToUTF8(channel), std::move(payload));
+		}
+
+		bool emitRaw(std::string_view u8channel, std::span<const std::byte> payload)
+		{
+			// 切断中はコピーする前に失敗させる
+			if (u8channel.empty() ||
+				connState != RedisConnectionState::Connected)
+			{
+				return false;
+			}
+
+			return enqueueEmit(std::string{ u8channel }, std::string{ reinterpret_cast<const char*>(payload.data()), payload.size() });
+		}
+
+		bool enqueueEmit(std::string&& u8channel, std::string&& payload)
+		{
+			if (connState != RedisConnectionState::Connected)
 			{
 				return false;
 			}
 
-			const std::string u8channel = Unicode::ToUTF8(channel);
-			const std::string payloadJson = payload.has_value()
-				? payload->formatUTF8Minimum()
-				: std::string{};
+			OutboundEvent event{
+				.channel = std::move(u8channel),
+				.payload = std::move(payload)
+			};
+
+			// 実際の送信は drainOutbound() で行う
+			return publisher().outboundQueue.tryPush(std::move(event));
+		}
+
+		bool publish(std::string_view u8channel, std::string_view payloadJson)
+		{
+			auto* context = conn->context();
+			if (!context)
+			{
+				return false;
+			}
 
 			const char* argv[3];
 			size_t argvlen[3];
 			argv[0] = "PUBLISH";           argvlen[0] = 7;
-			argv[1] = u8channel.c_str();   argvlen[1] = u8channel.size();
-			argv[2] = payloadJson.c_str(); argvlen[2] = payloadJson.size();
-
-			const int rc = redisAsyncCommandArgv(
-				context,
-				reinterpret_cast<redisCallbackFn*>(Impl::onPublishCallback),
-				this,
-				3, argv, argvlen
-			);
+			argv[1] = u8channel.data();    argvlen[1] = u8channel.size();
+			argv[2] = payloadJson.data();  argvlen[2] = payloadJson.size();
+
+			const int rc = (deliveryMode == DeliveryMode::FireAndForget)
+				? redisAsyncCommandArgv(
+					context,
+					reinterpret_cast<redisCallbackFn*>(Impl::onPublishCountCallback),
+					&publishCounters,
+					3, argv, argvlen)
+				: redisAsyncCommandArgv(
+					context,
+					reinterpret_cast<redisCallbackFn*>(Impl::onPublishCallback),
+					this,
+					3, argv, argvlen);
+			if (rc == REDIS_OK)
+			{
+				++publishCounters.sent;
+			}
 			return (rc == REDIS_OK);
 		}
 
-		bool subscribe(StringView channel)
+		ChannelId subscribe(StringView channel)
 		{
-			if (not ValidateChannelName(channel)) return false;
+			if (not ValidateChannelName(channel)) return ChannelId{};
 
 			// 購読している→成功
 			// 購読していない→成功
 
 			auto u8channel = Unicode::ToUTF8(channel);
+
+			std::lock_guard lock{ channelsMutex };
 			auto channelItr = channels.find(u8channel);
 			if (channelItr == channels.end())
 			{
+				auto info = std::make_unique<ChannelInfo>(ChannelInfo{
+					.index = channelCount++,
+					.name = String{ channel },
+					.utf8Name = u8channel
+				});
+				const ChannelId id{ info.get() };
+
 				channels.emplace(
-					u8channel,
+					std::move(u8channel),
 					ChannelState{
 						.desired = true,
-						.remote = false
+						.remote = false,
+						.info = std::move(info)
 					}
 				);
 				channelsDirty = true;
+				return id;
 			}
 			else
 			{
 				channelsDirty |= channelItr->second.desired == false;
 				channelItr->second.desired = true;
+				return ChannelId{ channelItr->second.info.get() };
+			}
+		}
+
+		ChannelId subscribe(StringView channel, EventHandler handler)
+		{
+			return addHandler(subscribe(channel), std::move(handler));
+		}
+
+		ChannelId addHandler(ChannelId id, EventHandler handler)
+		{
+			if (not id || not handler)
+			{
+				return id;
+			}
+
+			std::lock_guard lock{ channelsMutex };
+			stateOf(id).handlers.push_back(std::move(handler));
+			++handlersVersion;
+			return id;
+		}
+
+		ChannelId psubscribe(StringView pattern)
+		{
+			auto u8pattern = Unicode::ToUTF8(pattern);
+			if (not TopicTrie::IsValidPattern(u8pattern)) return ChannelId{};
+
+			std::lock_guard lock{ channelsMutex };
+			auto patternItr = patterns.find(u8pattern);
+			if (patternItr == patterns.end())
+			{
+				auto info = std::make_unique<ChannelInfo>(ChannelInfo{
+					.index = channelCount++,
+					.name = String{ pattern },
+					.utf8Name = u8pattern,
+					.isPattern = true
+				});
+				const ChannelId id{ info.get() };
+
+				std::string glob = TopicTrie::ToRedisGlob(u8pattern);
+				patterns.emplace(
+					std::move(u8pattern),
+					ChannelState{
+						.desired = true,
+						.remote = false,
+						.info = std::move(info),
+						.glob = std::move(glob)
+					}
+				);
+				channelsDirty = true;
+				patternTrieDirty = true;
+				return id;
+			}
+			else
+			{
+				if (not patternItr->second.desired)
+				{
+					patternItr->second.desired = true;
+					channelsDirty = true;
+					patternTrieDirty = true;
+				}
+				return ChannelId{ patternItr->second.info.get() };
+			}
+		}
+
+		bool punsubscribe(std::string_view u8pattern)
+		{
+			std::lock_guard lock{ channelsMutex };
+			auto patternItr = patterns.find(u8pattern);
+			if (patternItr == patterns.end() ||
+				not patternItr->second.desired)
+			{
+				return false;
 			}
 
+			channelsDirty = true;
+			patternTrieDirty = true;
+			patternItr->second.desired = false;
+			if (not patternItr->second.handlers.isEmpty())
+			{
+				patternItr->second.handlers.clear();
+				++handlersVersion;
+			}
 			return true;
 		}
 
+		ChannelId subscribe(StringView channel, ReceiveMode mode, EventHandler handler)
+		{
+			const ChannelId id = subscribe(channel, std::move(handler));
+			if (not id)
+			{
+				return id;
+			}
+
+			std::lock_guard lock{ channelsMutex };
+			auto& state = stateOf(id);
+			if (state.receiveMode != mode)
+			{
+				state.receiveMode = mode;
+				++handlersVersion;
+			}
+			return id;
+		}
+
+		// ハンドラ表と受信モード表を、登録状況が変わったときだけ作り直す
+		void syncChannelTables()
+		{
+			std::lock_guard lock{ channelsMutex };
+			if (dispatchVersion == handlersVersion)
+			{
+				return;
+			}
+
+			dispatchTable.clear();
+			dispatchTable.resize(channelCount);
+			receiveModes.assign(channelCount, ReceiveMode::All);
+			for (const auto* table : { &channels, &patterns })
+			{
+				for (const auto& [key, st] : *table)
+				{
+					dispatchTable[st.info->index] = st.handlers;
+					receiveModes[st.info->index] = st.receiveMode;
+				}
+			}
+			dispatchVersion = handlersVersion;
+		}
+
+		// 受信したイベントを、そのチャンネルのハンドラにのみ配送する
+		void dispatchEvents()
+		{
+			syncChannelTables();
+
+			// 受信順に配送する
+			for (const auto& ref : eventOrder)
+			{
+				if (dispatchTable.size() <= ref.bucket)
+				{
+					continue;
+				}
+
+				const auto& event = eventBuckets[ref.bucket][ref.index];
+
+				// ハンドラ内で subscribe() されても安全なようにインデックスで回す
+				for (size_t i = 0; i < dispatchTable[ref.bucket].size(); ++i)
+				{
+					dispatchTable[ref.bucket][i](event);
+				}
+			}
+		}
+
+		ChannelId findChannel(StringView channel) const
+		{
+			const auto u8channel = Unicode::ToUTF8(channel);
+
+			std::lock_guard lock{ channelsMutex };
+			if (auto channelItr = channels.find(u8channel); channelItr != channels.end())
+			{
+				return ChannelId{ channelItr->second.info.get() };
+			}
+			if (auto patternItr = patterns.find(u8channel); patternItr != patterns.end())
+			{
+				return ChannelId{ patternItr->second.info.get() };
+			}
+			return ChannelId{};
+		}
+
 		bool unsubscribe(StringView channel)
 		{
 			if (not ValidateChannelName(channel)) return false;
 
+			return unsubscribe(Unicode::ToUTF8(channel));
+		}
+
+		bool unsubscribe(std::string_view u8channel)
+		{
 			// 購読している→成功
 			// 購読していない→失敗
 
-			auto u8channel = Unicode::ToUTF8(channel);
+			std::lock_guard lock{ channelsMutex };
 			auto channelItr = channels.find(u8channel);
 			if (channelItr == channels.end())
 			{
@@ -243,12 +2656,38 @@ namespace MessageBus
 
 			channelsDirty = true;
 			channelItr->second.desired = false;
+			if (not channelItr->second.handlers.isEmpty() ||
+				channelItr->second.receiveMode != ReceiveMode::All)
+			{
+				channelItr->second.handlers.clear();
+				channelItr->second.receiveMode = ReceiveMode::All;
+				++handlersVersion;
+			}
 			return true;
 		}
 	};
 
+	const s3d::JSON& MessageBus::Event::value() const
+	{
+		if (not m_value)
+		{
+			m_value = PayloadCodec::Decode(m_payload);
+		}
+		return *m_value;
+	}
+
 	MessageBus::MessageBus(s3d::StringView ip, s3d::uint16 port, s3d::Optional<s3d::StringView> password)
-		: m_impl(std::make_unique<Impl>(ip, port, password))
+		: MessageBus(MessageBusOptions{ .ip = ip, .port = port, .password = password })
+	{
+	}
+
+	MessageBus::MessageBus(const MessageBusOptions& options)
+		: m_impl(std::make_unique<Impl>(options))
+	{
+	}
+
+	MessageBus::MessageBus(MessageBusHub& hub)
+		: m_impl(std::make_unique<Impl>(hub.m_impl))
 	{
 	}
 
@@ -256,52 +2695,316 @@ namespace MessageBus
 
 	void MessageBus::close()
 	{
-		m_impl->conn.disconnect();
+		// 接続はハブが持つため、ハブに接続している場合は何もしない（共有メモリは切断するものが無い）
+		if (m_impl->hub || m_impl->sharedMemory)
+		{
+			return;
+		}
+
+		if (m_impl->threaded)
+		{
+			// 切断はI/Oスレッドで行う
+			m_impl->closeRequested = true;
+			return;
+		}
+
+		m_impl->closeConnections();
 	}
 
 	void MessageBus::tick()
 	{
+		m_impl->frameCount.fetch_add(1, std::memory_order_release);
+		m_impl->eventLimit = SIZE_MAX;
+		m_impl->clearEventsBuffer();
+		m_impl->syncChannelTables();
+		m_impl->takeBacklog();
+
+		if (m_impl->hub)
+		{
+			m_impl->tickFrontEnd();
+			m_impl->receiveFromIoThread();
+		}
+		else if (m_impl->threaded)
+		{
+			m_impl->receiveFromIoThread();
+		}
+		else if (m_impl->sharedMemory)
+		{
+			m_impl->tickSharedMemory(SIZE_MAX);
+		}
+		else
+		{
+			// conn.tick の直前に差分バッチ送信
+			if (m_impl->conn->state() == RedisConnectionState::Connected)
+			{
+				if (m_impl->isChannelsDirty())
+				{
+					m_impl->reconcileSubscriptions(m_impl->conn->context());
+				}
+			}
+			m_impl->drainOutbound();
+			m_impl->refreshSlotsIfRequested();
+
+			m_impl->conn->tick();
+			m_impl->tickShards();
+			m_impl->tickStreams();
+			m_impl->connState = m_impl->conn->state();
+		}
+
+		m_impl->dispatchEvents();
+	}
+
+	void MessageBus::tick(s3d::Duration budget, size_t maxEvents)
+	{
+		m_impl->frameCount.fetch_add(1, std::memory_order_release);
+		const Stopwatch sw{ StartImmediately::Yes };
+
+		m_impl->eventLimit = maxEvents;
 		m_impl->clearEventsBuffer();
+		m_impl->syncChannelTables();
+		m_impl->takeBacklog();
+
+		if (m_impl->hub)
+		{
+			m_impl->tickFrontEnd();
+			m_impl->receiveFromIoThread(budget);
+		}
+		else if (m_impl->threaded)
+		{
+			// 持ち越し分は receiveFromIoThread() が上限で止めた分としてキューに残る
+			m_impl->receiveFromIoThread(budget);
+		}
+		else if (m_impl->sharedMemory)
+		{
+			m_impl->drainOutbound();
 
-		// conn.tick の直前に差分バッチ送信
-		if (m_impl->conn.state() == RedisConnectionState::Connected)
+			// 届いているものが無くなるか、時間かイベント数の上限に達するまで読み続ける
+			while (sw.elapsed() < budget &&
+				m_impl->eventOrder.size() < maxEvents &&
+				m_impl->pollSharedMemory(Min(maxEvents - m_impl->eventOrder.size(), SHARED_MEMORY_READ_BATCH)))
+			{
+			}
+		}
+		else
 		{
-			if (m_impl->channelsDirty)
+			if (m_impl->conn->state() == RedisConnectionState::Connected)
+			{
+				if (m_impl->isChannelsDirty())
+				{
+					m_impl->reconcileSubscriptions(m_impl->conn->context());
+				}
+			}
+			m_impl->drainOutbound();
+			m_impl->refreshSlotsIfRequested();
+
+			// 再接続・ハートビートと1回目の読み書き
+			m_impl->conn->tick();
+			m_impl->tickShards();
+			m_impl->tickStreams();
+
+			// ソケットが空になるか、時間かイベント数の上限に達するまで読み続ける
+			while (sw.elapsed() < budget &&
+				m_impl->eventOrder.size() < maxEvents &&
+				m_impl->pollConnections())
 			{
-				m_impl->reconcileSubscriptions(m_impl->conn.context());
 			}
+
+			m_impl->connState = m_impl->conn->state();
 		}
 
-		m_impl->conn.tick();
+		m_impl->dispatchEvents();
+	}
+
+	size_t MessageBus::backlog() const
+	{
+		return m_impl->backlog.size() + m_impl->inboundQueue.sizeApprox();
 	}
 
 	bool MessageBus::isConnected() const
 	{
-		return m_impl->conn.state() == RedisConnectionState::Connected;
+		return m_impl->connState == RedisConnectionState::Connected;
+	}
+
+	MessageBus::PublishStats MessageBus::publishStats() const
+	{
+		const auto& counters = m_impl->publisher().publishCounters;
+		return PublishStats{
+			.sent = counters.sent,
+			.replied = counters.replied,
+			.delivered = counters.delivered,
+			.errors = counters.errors,
+			.coalesced = counters.coalesced,
+			.rateLimited = counters.rateLimited,
+			.dropped = counters.dropped,
+		};
+	}
+
+	MessageBus::AllocatorStats MessageBus::allocatorStats()
+	{
+		const HiredisAllocatorCounters counters = HiredisAllocator::Counters();
+		return AllocatorStats{
+			.allocations = counters.allocations,
+			.poolHits = counters.poolHits,
+			.upstreamAllocations = counters.upstreamAllocations,
+			.bytesInUse = counters.bytesInUse,
+			.peakBytesInUse = counters.peakBytesInUse,
+			.reservedBytes = counters.reservedBytes,
+			.peakReservedBytes = counters.peakReservedBytes,
+		};
 	}
 
 	const s3d::String& MessageBus::error() const
 	{
-		return m_impl->conn.error();
+		if (m_impl->threaded)
+		{
+			return m_impl->errorSnapshot;
+		}
+		return m_impl->conn
+			? m_impl->conn->error()
+			: m_impl->sharedError;
 	}
 
-	bool MessageBus::subscribe(s3d::StringView channel)
+	ChannelId MessageBus::subscribe(s3d::StringView channel)
 	{
 		return m_impl->subscribe(channel);
 	}
 
+	ChannelId MessageBus::subscribe(s3d::StringView channel, EventHandler handler)
+	{
+		return m_impl->subscribe(channel, std::move(handler));
+	}
+
+	ChannelId MessageBus::subscribe(s3d::StringView channel, ReceiveMode mode)
+	{
+		return m_impl->subscribe(channel, mode, nullptr);
+	}
+
+	ChannelId MessageBus::subscribe(s3d::StringView channel, ReceiveMode mode, EventHandler handler)
+	{
+		return m_impl->subscribe(channel, mode, std::move(handler));
+	}
+
 	bool MessageBus::unsubscribe(s3d::StringView channel)
 	{
 		return m_impl->unsubscribe(channel);
 	}
 
-	const s3d::Array<MessageBus::Event>& MessageBus::events() const
+	ChannelId MessageBus::psubscribe(s3d::StringView pattern)
+	{
+		return m_impl->psubscribe(pattern);
+	}
+
+	ChannelId MessageBus::psubscribe(s3d::StringView pattern, EventHandler handler)
+	{
+		return m_impl->addHandler(m_impl->psubscribe(pattern), std::move(handler));
+	}
+
+	bool MessageBus::punsubscribe(s3d::StringView pattern)
+	{
+		return m_impl->punsubscribe(Unicode::ToUTF8(pattern));
+	}
+
+	bool MessageBus::unsubscribe(ChannelId channel)
+	{
+		if (not channel) return false;
+
+		if (channel.info()->isPattern)
+		{
+			return m_impl->punsubscribe(channel.utf8Name());
+		}
+
+		return m_impl->unsubscribe(channel.utf8Name());
+	}
+
+	ChannelId MessageBus::findChannel(s3d::StringView channel) const
+	{
+		return m_impl->findChannel(channel);
+	}
+
+	MessageBus::EventList MessageBus::events() const
+	{
+		return EventList{ m_impl->eventBuckets, m_impl->eventOrder };
+	}
+
+	std::span<const MessageBus::Event> MessageBus::events(ChannelId channel) const
+	{
+		return m_impl->eventsOf(channel);
+	}
+
+	std::span<const MessageBus::Event> MessageBus::events(s3d::StringView channel) const
 	{
-		return m_impl->eventsBuf;
+		return m_impl->eventsOf(m_impl->findChannel(channel));
 	}
 
-	bool MessageBus::emit(s3d::StringView channel, s3d::Optional<s3d::JSON> payload)
+	bool MessageBus::emit(s3d::StringView channel, const s3d::Optional<s3d::JSON>& payload)
 	{
 		return m_impl->emit(channel, payload);
 	}
+
+	bool MessageBus::emitPayload(s3d::StringView channel, std::string&& payload)
+	{
+		return m_impl->emitPayload(channel, std::move(payload));
+	}
+
+	bool MessageBus::emitRaw(ChannelId channel, std::span<const std::byte> payload)
+	{
+		if (not channel || channel.info()->isPattern)
+		{
+			return false;
+		}
+		return m_impl->emitRaw(channel.utf8Name(), payload);
+	}
+
+	bool MessageBus::emitRaw(std::string_view u8channel, std::span<const std::byte> payload)
+	{
+		return m_impl->emitRaw(u8channel, payload);
+	}
+
+	PayloadFormat MessageBus::payloadFormat() const noexcept
+	{
+		return m_impl->payloadFormat;
+	}
+
+	void MessageBus::setEmitOptions(s3d::StringView channel, const EmitOptions& options)
+	{
+		m_impl->publisher().setEmitOptions(channel, options);
+	}
+
+	ChannelId MessageBus::declareStream(s3d::StringView channel, const StreamOptions& options)
+	{
+		if (m_impl->hub)
+		{
+			// ストリームはハブが読み込み、購読している MessageBus に配る
+			if (not m_impl->hub->declareStream(channel, options))
+			{
+				return ChannelId{};
+			}
+			return m_impl->subscribe(channel);
+		}
+
+		return m_impl->declareStream(channel, options);
+	}
+
+	MessageBusHub::MessageBusHub(s3d::StringView ip, s3d::uint16 port, s3d::Optional<s3d::StringView> password)
+		: MessageBusHub(MessageBusOptions{ .ip = ip, .port = port, .password = password })
+	{
+	}
+
+	MessageBusHub::MessageBusHub(const MessageBusOptions& options)
+		: m_impl(std::make_shared<MessageBus::Impl>(options, true))
+	{
+	}
+
+	MessageBusHub::~MessageBusHub() = default;
+
+	bool MessageBusHub::isConnected() const
+	{
+		return m_impl->connState == RedisConnectionState::Connected;
+	}
+
+	size_t MessageBusHub::frontEndCount() const
+	{
+		std::lock_guard lock{ m_impl->frontEndsMutex };
+		return m_impl->frontEnds.size();
+	}
 }
@@ -0,0 +1,716 @@
+﻿#include "MessageBus/PayloadCodec.hpp"
+#include "MessageBus/Serialization.hpp"
+#include <Siv3D/Array.hpp>
+#include <Siv3D/Unicode.hpp>
+#include <bit>
+#include <charconv>
+#include <cmath>
+
+using namespace s3d;
+
+namespace MessageBus
+{
+	namespace
+	{
+		// 入れ子の上限（不正なペイロードでスタックを使い切らないようにする）
+		constexpr size_t MAX_DECODE_DEPTH = 64;
+
+		template <class Type>
+		void AppendBigEndian(std::string& out, Type value)
+		{
+			for (int shift = (sizeof(Type) - 1) * 8; 0 <= shift; shift -= 8)
+			{
+				out.push_back(static_cast<char>(static_cast<uint8>(static_cast<uint64>(value) >> shift)));
+			}
+		}
+
+		void AppendHeader(std::string& out, uint8 tag)
+		{
+			out.push_back(static_cast<char>(tag));
+		}
+
+		// 要素数などの長さ付きヘッダ（fix 形式に収まらない場合は 8/16/32 ビット長の形式を使う）
+		void AppendSizedHeader(std::string& out, size_t size, uint8 fixTag, size_t fixLimit, int tag8, uint8 tag16, uint8 tag32)
+		{
+			if (size < fixLimit)
+			{
+				AppendHeader(out, static_cast<uint8>(fixTag | size));
+			}
+			else if (0 <= tag8 && size <= UINT8_MAX)
+			{
+				AppendHeader(out, static_cast<uint8>(tag8));
+				AppendBigEndian(out, static_cast<uint8>(size));
+			}
+			else if (size <= UINT16_MAX)
+			{
+				AppendHeader(out, tag16);
+				AppendBigEndian(out, static_cast<uint16>(size));
+			}
+			else
+			{
+				AppendHeader(out, tag32);
+				AppendBigEndian(out, static_cast<uint32>(size));
+			}
+		}
+
+		void EncodeJSON(MessagePackWriter& writer, const JSON& value)
+		{
+			switch (value.getType())
+			{
+			case JSONValueType::Bool:
+				writer.writeBool(value.get<bool>());
+				return;
+			case JSONValueType::Number:
+				if (value.isUnsigned())
+				{
+					writer.writeUInt(value.get<uint64>());
+				}
+				else if (value.isInteger())
+				{
+					writer.writeInt(value.get<int64>());
+				}
+				else
+				{
+					writer.writeDouble(value.get<double>());
+				}
+				return;
+			case JSONValueType::String:
+				writer.writeString(Unicode::ToUTF8(value.getString()));
+				return;
+			case JSONValueType::Array:
+				writer.writeArrayHeader(value.size());
+				for (const auto& element : value.arrayView())
+				{
+					EncodeJSON(writer, element);
+				}
+				return;
+			case JSONValueType::Object:
+				writer.writeMapHeader(value.size());
+				for (const auto& object : value)
+				{
+					writer.writeString(Unicode::ToUTF8(object.key));
+					EncodeJSON(writer, object.value);
+				}
+				return;
+			default:
+				writer.writeNil();
+				return;
+			}
+		}
+
+		// MessagePack を JSON へ変換する
+		[[nodiscard]]
+		bool DecodeJSON(MessagePackReader& reader, JSON& out, size_t depth)
+		{
+			MessagePackReader::Token token;
+			if (MAX_DECODE_DEPTH < depth || not reader.next(token))
+			{
+				return false;
+			}
+
+			switch (token.type)
+			{
+			case MessagePackReader::Type::Nil:
+				out = JSON(nullptr);
+				return true;
+			case MessagePackReader::Type::Bool:
+				out = JSON(token.boolean);
+				return true;
+			case MessagePackReader::Type::Int:
+				out = JSON(token.integer);
+				return true;
+			case MessagePackReader::Type::UInt:
+				out = JSON(token.unsignedInteger);
+				return true;
+			case MessagePackReader::Type::Float:
+				out = JSON(token.floating);
+				return true;
+			case MessagePackReader::Type::String:
+				out = JSON(Unicode::FromUTF8(token.string));
+				return true;
+			case MessagePackReader::Type::Array:
+				{
+					Array<JSON> elements(token.size);
+					for (auto& element : elements)
+					{
+						if (not DecodeJSON(reader, element, depth + 1))
+						{
+							return false;
+						}
+					}
+					out = JSON(elements);
+					return true;
+				}
+			case MessagePackReader::Type::Map:
+				{
+					JSON object;
+					for (size_t i = 0; i < token.size; ++i)
+					{
+						// キーは文字列のみ対応する
+						MessagePackReader::Token key;
+						if (not reader.next(key) || key.type != MessagePackReader::Type::String)
+						{
+							return false;
+						}
+
+						JSON value;
+						if (not DecodeJSON(reader, value, depth + 1))
+						{
+							return false;
+						}
+						object[Unicode::FromUTF8(key.string)] = value;
+					}
+					out = object;
+					return true;
+				}
+			default:
+				return false;
+			}
+		}
+
+		// JSON 文字列のエスケープ
+		void AppendJSONString(std::string& out, std::string_view value)
+		{
+			constexpr char Hex[] = "0123456789abcdef";
+
+			out.push_back('"');
+			for (const char ch : value)
+			{
+				switch (ch)
+				{
+				case '"':  out += "\\\""; break;
+				case '\\': out += "\\\\"; break;
+				case '\b': out += "\\b"; break;
+				case '\f': out += "\\f"; break;
+				case '\n': out += "\\n"; break;
+				case '\r': out += "\\r"; break;
+				case '\t': out += "\\t"; break;
+				default:
+					if (static_cast<uint8>(ch) < 0x20)
+					{
+						out += "\\u00";
+						out.push_back(Hex[static_cast<uint8>(ch) >> 4]);
+						out.push_back(Hex[static_cast<uint8>(ch) & 0x0F]);
+					}
+					else
+					{
+						out.push_back(ch);
+					}
+					break;
+				}
+			}
+			out.push_back('"');
+		}
+
+		template <class Type>
+		void AppendNumber(std::string& out, Type value)
+		{
+			char buffer[32];
+			const auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), value);
+			out.append(buffer, end);
+		}
+	}
+
+	// ================================
+	// MessagePackReader
+	// ================================
+
+	bool MessagePackReader::next(Token& token)
+	{
+		if (atEnd())
+		{
+			return false;
+		}
+
+		const auto readBytes = [this](size_t size, std::string_view& out) {
+			if (remaining() < size)
+			{
+				return false;
+			}
+			out = m_data.substr(m_pos, size);
+			m_pos += size;
+			return true;
+		};
+
+		const auto readBigEndian = [&](size_t size, uint64& out) {
+			std::string_view bytes;
+			if (not readBytes(size, bytes))
+			{
+				return false;
+			}
+			out = 0;
+			for (const char byte : bytes)
+			{
+				out = (out << 8) | static_cast<uint8>(byte);
+			}
+			return true;
+		};
+
+		const auto setInt = [&](int64 value) {
+			token.type = Type::Int;
+			token.integer = value;
+			return true;
+		};
+
+		const auto setString = [&](uint64 size) {
+			token.type = Type::String;
+			return readBytes(static_cast<size_t>(size), token.string);
+		};
+
+		// 要素は最低1バイト（マップは2バイト）なので、残りより多い要素数は不正
+		const auto setContainer = [&](Type type, uint64 size) {
+			token.type = type;
+			token.size = static_cast<size_t>(size);
+			return size <= remaining() / ((type == Type::Map) ? 2 : 1);
+		};
+
+		const uint8 tag = static_cast<uint8>(m_data[m_pos++]);
+
+		// fix 形式
+		if (tag <= 0x7F)
+		{
+			return setInt(tag);
+		}
+		if (0xE0 <= tag)
+		{
+			return setInt(static_cast<int8>(tag));
+		}
+		if ((tag & 0xF0) == 0x80)
+		{
+			return setContainer(Type::Map, tag & 0x0F);
+		}
+		if ((tag & 0xF0) == 0x90)
+		{
+			return setContainer(Type::Array, tag & 0x0F);
+		}
+		if ((tag & 0xE0) == 0xA0)
+		{
+			return setString(tag & 0x1F);
+		}
+
+		uint64 value = 0;
+		switch (tag)
+		{
+		case 0xC0:
+			token.type = Type::Nil;
+			return true;
+		case 0xC2:
+		case 0xC3:
+			token.type = Type::Bool;
+			token.boolean = (tag == 0xC3);
+			return true;
+		case 0xCA:
+			if (not readBigEndian(4, value)) return false;
+			token.type = Type::Float;
+			token.floating = std::bit_cast<float>(static_cast<uint32>(value));
+			return true;
+		case 0xCB:
+			if (not readBigEndian(8, value)) return false;
+			token.type = Type::Float;
+			token.floating = std::bit_cast<double>(value);
+			return true;
+		case 0xCC:
+		case 0xCD:
+		case 0xCE:
+			return readBigEndian(size_t{ 1 } << (tag - 0xCC), value) && setInt(static_cast<int64>(value));
+		case 0xCF:
+			if (not readBigEndian(8, value)) return false;
+			if (value <= static_cast<uint64>(INT64_MAX))
+			{
+				return setInt(static_cast<int64>(value));
+			}
+			token.type = Type::UInt;
+			token.unsignedInteger = value;
+			return true;
+		case 0xD0:
+			return readBigEndian(1, value) && setInt(static_cast<int8>(value));
+		case 0xD1:
+			return readBigEndian(2, value) && setInt(static_cast<int16>(value));
+		case 0xD2:
+			return readBigEndian(4, value) && setInt(static_cast<int32>(value));
+		case 0xD3:
+			return readBigEndian(8, value) && setInt(static_cast<int64>(value));
+		case 0xD9:
+			return readBigEndian(1, value) && setString(value);
+		case 0xDA:
+			return readBigEndian(2, value) && setString(value);
+		case 0xDB:
+			return readBigEndian(4, value) && setString(value);
+		case 0xDC:
+			return readBigEndian(2, value) && setContainer(Type::Array, value);
+		case 0xDD:
+			return readBigEndian(4, value) && setContainer(Type::Array, value);
+		case 0xDE:
+			return readBigEndian(2, value) && setContainer(Type::Map, value);
+		case 0xDF:
+			return readBigEndian(4, value) && setContainer(Type::Map, value);
+		default:
+			// bin / ext は JSON で表せないため未対応
+			return false;
+		}
+	}
+
+	bool MessagePackReader::skip()
+	{
+		return skip(0);
+	}
+
+	bool MessagePackReader::skip(size_t depth)
+	{
+		Token token;
+		if (MAX_DECODE_DEPTH < depth || not next(token))
+		{
+			return false;
+		}
+
+		const size_t children = (token.type == Type::Array) ? token.size
+			: (token.type == Type::Map) ? (token.size * 2)
+			: 0;
+		for (size_t i = 0; i < children; ++i)
+		{
+			if (not skip(depth + 1))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// ================================
+	// MessagePackWriter
+	// ================================
+
+	void MessagePackWriter::writeNil()
+	{
+		AppendHeader(m_out, 0xC0);
+	}
+
+	void MessagePackWriter::writeBool(bool value)
+	{
+		AppendHeader(m_out, value ? 0xC3 : 0xC2);
+	}
+
+	void MessagePackWriter::writeInt(int64 value)
+	{
+		if (0 <= value)
+		{
+			writeUInt(static_cast<uint64>(value));
+		}
+		else if (-32 <= value)
+		{
+			AppendHeader(m_out, static_cast<uint8>(static_cast<int8>(value)));
+		}
+		else if (INT8_MIN <= value)
+		{
+			AppendHeader(m_out, 0xD0);
+			AppendBigEndian(m_out, static_cast<uint8>(static_cast<int8>(value)));
+		}
+		else if (INT16_MIN <= value)
+		{
+			AppendHeader(m_out, 0xD1);
+			AppendBigEndian(m_out, static_cast<uint16>(static_cast<int16>(value)));
+		}
+		else if (INT32_MIN <= value)
+		{
+			AppendHeader(m_out, 0xD2);
+			AppendBigEndian(m_out, static_cast<uint32>(static_cast<int32>(value)));
+		}
+		else
+		{
+			AppendHeader(m_out, 0xD3);
+			AppendBigEndian(m_out, static_cast<uint64>(value));
+		}
+	}
+
+	void MessagePackWriter::writeUInt(uint64 value)
+	{
+		if (value <= 0x7F)
+		{
+			AppendHeader(m_out, static_cast<uint8>(value));
+		}
+		else if (value <= UINT8_MAX)
+		{
+			AppendHeader(m_out, 0xCC);
+			AppendBigEndian(m_out, static_cast<uint8>(value));
+		}
+		else if (value <= UINT16_MAX)
+		{
+			AppendHeader(m_out, 0xCD);
+			AppendBigEndian(m_out, static_cast<uint16>(value));
+		}
+		else if (value <= UINT32_MAX)
+		{
+			AppendHeader(m_out, 0xCE);
+			AppendBigEndian(m_out, static_cast<uint32>(value));
+		}
+		else
+		{
+			AppendHeader(m_out, 0xCF);
+			AppendBigEndian(m_out, value);
+		}
+	}
+
+	void MessagePackWriter::writeDouble(double value)
+	{
+		const float narrowed = static_cast<float>(value);
+		if (static_cast<double>(narrowed) == value)
+		{
+			AppendHeader(m_out, 0xCA);
+			AppendBigEndian(m_out, std::bit_cast<uint32>(narrowed));
+		}
+		else
+		{
+			AppendHeader(m_out, 0xCB);
+			AppendBigEndian(m_out, std::bit_cast<uint64>(value));
+		}
+	}
+
+	void MessagePackWriter::writeString(std::string_view value)
+	{
+		AppendSizedHeader(m_out, value.size(), 0xA0, 32, 0xD9, 0xDA, 0xDB);
+		m_out.append(value);
+	}
+
+	void MessagePackWriter::writeArrayHeader(size_t size)
+	{
+		AppendSizedHeader(m_out, size, 0x90, 16, -1, 0xDC, 0xDD);
+	}
+
+	void MessagePackWriter::writeMapHeader(size_t size)
+	{
+		AppendSizedHeader(m_out, size, 0x80, 16, -1, 0xDE, 0xDF);
+	}
+
+	// ================================
+	// PayloadWriter
+	// ================================
+
+	PayloadWriter::PayloadWriter(std::string& out, PayloadFormat format)
+		: m_out(out)
+		, m_format(format)
+		, m_msgpack(out)
+	{
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			m_out.push_back(static_cast<char>(BINARY_PAYLOAD_MARKER));
+		}
+	}
+
+	void PayloadWriter::beginValue()
+	{
+		if (m_format != PayloadFormat::JSON)
+		{
+			return;
+		}
+
+		if (m_afterKey)
+		{
+			m_afterKey = false;
+			return;
+		}
+
+		if (not m_first.empty())
+		{
+			if (not m_first.back())
+			{
+				m_out.push_back(',');
+			}
+			m_first.back() = false;
+		}
+	}
+
+	void PayloadWriter::beginObject(size_t size)
+	{
+		beginValue();
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			m_msgpack.writeMapHeader(size);
+			return;
+		}
+		m_out.push_back('{');
+		m_first.push_back(true);
+	}
+
+	void PayloadWriter::key(std::string_view name)
+	{
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			m_msgpack.writeString(name);
+			return;
+		}
+		beginValue();
+		AppendJSONString(m_out, name);
+		m_out.push_back(':');
+		m_afterKey = true;
+	}
+
+	void PayloadWriter::endObject()
+	{
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			return;
+		}
+		m_first.pop_back();
+		m_out.push_back('}');
+	}
+
+	void PayloadWriter::beginArray(size_t size)
+	{
+		beginValue();
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			m_msgpack.writeArrayHeader(size);
+			return;
+		}
+		m_out.push_back('[');
+		m_first.push_back(true);
+	}
+
+	void PayloadWriter::endArray()
+	{
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			return;
+		}
+		m_first.pop_back();
+		m_out.push_back(']');
+	}
+
+	void PayloadWriter::writeNil()
+	{
+		beginValue();
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			m_msgpack.writeNil();
+			return;
+		}
+		m_out += "null";
+	}
+
+	void PayloadWriter::writeBool(bool value)
+	{
+		beginValue();
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			m_msgpack.writeBool(value);
+			return;
+		}
+		m_out += (value ? "true" : "false");
+	}
+
+	void PayloadWriter::writeInt(int64 value)
+	{
+		beginValue();
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			m_msgpack.writeInt(value);
+			return;
+		}
+		AppendNumber(m_out, value);
+	}
+
+	void PayloadWriter::writeUInt(uint64 value)
+	{
+		beginValue();
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			m_msgpack.writeUInt(value);
+			return;
+		}
+		AppendNumber(m_out, value);
+	}
+
+	void PayloadWriter::writeDouble(double value)
+	{
+		beginValue();
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			m_msgpack.writeDouble(value);
+			return;
+		}
+
+		if (not std::isfinite(value))
+		{
+			m_out += "null";
+			return;
+		}
+		AppendNumber(m_out, value);
+	}
+
+	void PayloadWriter::writeString(std::string_view value)
+	{
+		beginValue();
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			m_msgpack.writeString(value);
+			return;
+		}
+		AppendJSONString(m_out, value);
+	}
+
+	void PayloadWriter::writeJSON(const JSON& value)
+	{
+		beginValue();
+		if (m_format == PayloadFormat::MessagePack)
+		{
+			EncodeJSON(m_msgpack, value);
+			return;
+		}
+		m_out += value.formatUTF8Minimum();
+	}
+
+	// ================================
+	// PayloadTraits<JSON>
+	// ================================
+
+	bool PayloadTraits<JSON>::Read(MessagePackReader& reader, JSON& out)
+	{
+		return DecodeJSON(reader, out, 0);
+	}
+
+	// ================================
+	// PayloadCodec
+	// ================================
+
+	namespace PayloadCodec
+	{
+		void Encode(const JSON& value, PayloadFormat format, std::string& out)
+		{
+			PayloadWriter writer{ out, format };
+			writer.writeJSON(value);
+		}
+
+		std::string Encode(const JSON& value, PayloadFormat format)
+		{
+			std::string out;
+			Encode(value, format, out);
+			return out;
+		}
+
+		bool IsBinary(std::string_view payload) noexcept
+		{
+			return (not payload.empty()) && (static_cast<uint8>(payload.front()) == BINARY_PAYLOAD_MARKER);
+		}
+
+		JSON Decode(std::string_view payload)
+		{
+			if (payload.empty())
+			{
+				return JSON::Invalid();
+			}
+
+			if (IsBinary(payload))
+			{
+				JSON value;
+				MessagePackReader reader{ payload.substr(1) };
+				if (not DecodeJSON(reader, value, 0) || not reader.atEnd())
+				{
+					return JSON::Invalid();
+				}
+				return value;
+			}
+
+			return JSON::Parse(Unicode::FromUTF8(payload));
+		}
+	}
+}
@@ -1,5 +1,8 @@
 ﻿#include "MessageBus/RedisConnection.hpp"
 #include "MessageBus/GeneratedLicenses.hpp"
+#include "RedisMessageReader.hpp"
+#include "HiredisAllocator.hpp"
+#include "HostResolver.hpp"
 
 extern "C"
 {
@@ -28,11 +31,15 @@ namespace MessageBus
 		m_password(options.password
 					? MakeOptional<String>(options.password.value())
 					: Optional<String>{}),
+		m_unixSocket(options.unixSocket
+					? MakeOptional<String>(options.unixSocket.value())
+					: Optional<String>{}),
 		m_reconnectTimer(Seconds{ 0 }, StartImmediately::No),
 		m_heartbeatInterval(options.heartbeatInterval),
 		m_state(RedisConnectionState::Disconnected),
 		m_onConnect(options.onConnect), m_onReady(options.onReady),
-		m_onDisconnect(options.onDisconnect), m_onPush(options.onPush)
+		m_onDisconnect(options.onDisconnect), m_onPush(options.onPush),
+		m_onMessage(options.onMessage)
 	{
 		const auto& licenses = LicenseManager::EnumLicenses();
 		const auto& hiredisLicense = Generated::HiredisLicense();
@@ -42,6 +49,19 @@ namespace MessageBus
 			LicenseManager::AddLicense(hiredisLicense);
 		}
 
+		// hiredis が最初に確保する前に確保関数を決める（既定の malloc / free の場合は何も登録しない）
+		if (options.pooledAllocator)
+		{
+			if (not HiredisAllocator::Install())
+			{
+				Logger << U"[Redis][ERROR] pooledAllocator is ignored: hiredis is already using the default allocator in this process";
+			}
+		}
+		else
+		{
+			HiredisAllocator::UseDefault();
+		}
+
 		tryConnect();
 	}
 
@@ -54,11 +74,14 @@ namespace MessageBus
 		}
 	}
 
-	void RedisConnection::tick()
+	void RedisConnection::tick(s3d::Duration pollTimeout)
 	{
-		if (m_context)
+		poll(pollTimeout);
+
+		// ホスト名の解決が終わっていれば接続を始める
+		if (m_resolving)
 		{
-			redisPollTick(m_context, 0.0);
+			tryConnect();
 		}
 
 		if (m_state == RedisConnectionState::Disconnected ||
@@ -80,6 +103,17 @@ namespace MessageBus
 		}
 	}
 
+	bool RedisConnection::poll(s3d::Duration pollTimeout)
+	{
+		if (!m_context)
+		{
+			return false;
+		}
+
+		const int handled = redisPollTick(m_context, pollTimeout.count());
+		return (0 < handled) && (handled & REDIS_POLL_HANDLED_READ);
+	}
+
 	void RedisConnection::disconnect()
 	{
 		// 手動切断では再接続を抑止
@@ -88,18 +122,58 @@ namespace MessageBus
 		{
 			redisAsyncDisconnect(m_context);
 		}
+		else if (m_resolving)
+		{
+			m_resolving = false;
+			setState(RedisConnectionState::Disconnected);
+		}
 	}
 
 	void RedisConnection::tryConnect()
 	{
 		setState(RedisConnectionState::Connecting);
 
-		Logger << U"[Redis][INFO] ip=" << m_ip << U", port=" << m_port;
-
 		// 非同期接続オプションを設定
 		redisOptions options = { 0 };
-		std::string ipStr = m_ip.narrow();
-		REDIS_OPTIONS_SET_TCP(&options, ipStr.c_str(), m_port);
+		std::string ipStr;
+		std::string socketPath;
+		if (m_unixSocket)
+		{
+			Logger << U"[Redis][INFO] unixSocket=" << *m_unixSocket;
+
+#if defined(_WIN32)
+			// hiredis は Windows で AF_UNIX に対応していない（再接続しても成功しないため再接続しない）
+			failure(U"Initialization Error: Unix domain sockets are not supported on Windows", false);
+			return;
+#else
+			socketPath = Unicode::ToUTF8(*m_unixSocket);
+			REDIS_OPTIONS_SET_UNIX(&options, socketPath.c_str());
+#endif
+		}
+		else
+		{
+			if (not m_resolving)
+			{
+				Logger << U"[Redis][INFO] ip=" << m_ip << U", port=" << m_port;
+			}
+
+			// getaddrinfo はバックグラウンドで行い、解決済みの数値アドレスにのみ接続する
+			const HostResolveResult resolved = HostResolver::Lookup(m_ip.narrow());
+			m_resolving = (resolved.status == HostResolveStatus::Pending);
+			if (m_resolving)
+			{
+				return;
+			}
+
+			if (resolved.status == HostResolveStatus::Failed)
+			{
+				failure(U"Connection Error: Failed to resolve {} ({})"_fmt(m_ip, Unicode::FromUTF8(resolved.error)), true);
+				return;
+			}
+
+			ipStr = resolved.address;
+			REDIS_OPTIONS_SET_TCP(&options, ipStr.c_str(), m_port);
+		}
 		options.async_push_cb = reinterpret_cast<redisAsyncPushFn*>(RedisConnection::onPushCallback);
 
 		m_context = redisAsyncConnectWithOptions(&options);
@@ -123,6 +197,12 @@ namespace MessageBus
 		m_context->data = this;
 		m_context->dataCleanup = nullptr;
 
+		// 購読メッセージを redisReply を経由せずに受け取るリーダーに差し替える
+		if (m_onMessage)
+		{
+			InstallMessageReader(m_context->c, &m_onMessage);
+		}
+
 		// poll.hアダプタをアタッチ
 		if (redisPollAttach(m_context) != REDIS_OK)
 		{
@@ -211,6 +291,12 @@ namespace MessageBus
 		}
 		else
 		{
+			// アドレスが変わった可能性があるため、次の再接続では名前を解決し直す
+			if (not self->m_unixSocket)
+			{
+				HostResolver::Invalidate(self->m_ip.narrow());
+			}
+
 			self->failure(U"Connection Error: {}"_fmt(Unicode::FromUTF8(ac->errstr)), true);
 			self->m_context = nullptr;
 		}
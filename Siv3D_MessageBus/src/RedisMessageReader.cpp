@@ -0,0 +1,265 @@
+﻿#include "RedisMessageReader.hpp"
+#include <cstring>
+
+extern "C" {
+#include <hiredis/alloc.h>
+}
+
+namespace MessageBus
+{
+	namespace
+	{
+		// 直接デコード済みのペイロード要素の代わりに置く共有オブジェクト
+		// hiredis の購読ディスパッチは kind と channel（pmessage では pattern）の要素しか読まないため、中身は空でよい
+		char g_emptyString[] = "";
+		redisReply g_decodedPayload{ .type = REDIS_REPLY_STRING, .len = 0, .str = g_emptyString };
+
+		void AttachToParent(const redisReadTask* task, redisReply* reply)
+		{
+			if (task->parent)
+			{
+				static_cast<redisReply*>(task->parent->obj)->element[task->idx] = reply;
+			}
+		}
+
+		redisReply* CreateReply(const redisReadTask* task)
+		{
+			auto* reply = static_cast<redisReply*>(hi_calloc(1, sizeof(redisReply)));
+			if (reply)
+			{
+				reply->type = task->type;
+			}
+			return reply;
+		}
+
+		std::string_view StringOf(const redisReply* reply)
+		{
+			return (reply && reply->type == REDIS_REPLY_STRING)
+				? std::string_view{ reply->str, reply->len }
+				: std::string_view{};
+		}
+
+		// トップレベルの ["message", channel, payload] / ["pmessage", pattern, channel, payload] のペイロード要素かを判定する
+		bool IsMessagePayload(const redisReadTask* task, std::string_view& pattern, std::string_view& channel)
+		{
+			if (task->type != REDIS_REPLY_STRING ||
+				task->idx < 2 ||
+				!task->parent ||
+				task->parent->parent)
+			{
+				return false;
+			}
+
+			const auto* parent = static_cast<const redisReply*>(task->parent->obj);
+			if ((parent->type != REDIS_REPLY_PUSH && parent->type != REDIS_REPLY_ARRAY) ||
+				parent->elements != static_cast<size_t>(task->idx) + 1)
+			{
+				return false;
+			}
+
+			const std::string_view kind = StringOf(parent->element[0]);
+			if (task->idx == 2 && (kind == "message" || kind == "smessage"))
+			{
+				pattern = {};
+				channel = StringOf(parent->element[1]);
+				return (channel.data() != nullptr);
+			}
+			if (task->idx == 3 && kind == "pmessage")
+			{
+				pattern = StringOf(parent->element[1]);
+				channel = StringOf(parent->element[2]);
+				return (pattern.data() != nullptr) && (channel.data() != nullptr);
+			}
+			return false;
+		}
+
+		void* CreateString(const redisReadTask* task, char* str, size_t len)
+		{
+			// 購読メッセージのペイロードはリーダーのバッファから直接渡す
+			if (const auto* handler = static_cast<const RedisMessageHandler*>(task->privdata))
+			{
+				std::string_view pattern;
+				std::string_view channel;
+				if (IsMessagePayload(task, pattern, channel))
+				{
+					(*handler)(pattern, channel, std::string_view{ str, len });
+					AttachToParent(task, &g_decodedPayload);
+					return &g_decodedPayload;
+				}
+			}
+
+			redisReply* reply = CreateReply(task);
+			if (!reply)
+			{
+				return nullptr;
+			}
+
+			// VERB は先頭の "txt:" を型として分離する
+			if (task->type == REDIS_REPLY_VERB)
+			{
+				if (len < 4)
+				{
+					hi_free(reply);
+					return nullptr;
+				}
+				std::memcpy(reply->vtype, str, 3);
+				reply->vtype[3] = '\0';
+				str += 4;
+				len -= 4;
+			}
+
+			auto* buf = static_cast<char*>(hi_malloc(len + 1));
+			if (!buf)
+			{
+				hi_free(reply);
+				return nullptr;
+			}
+			std::memcpy(buf, str, len);
+			buf[len] = '\0';
+
+			reply->str = buf;
+			reply->len = len;
+			AttachToParent(task, reply);
+			return reply;
+		}
+
+		void* CreateArray(const redisReadTask* task, size_t elements)
+		{
+			redisReply* reply = CreateReply(task);
+			if (!reply)
+			{
+				return nullptr;
+			}
+
+			if (elements > 0)
+			{
+				reply->element = static_cast<redisReply**>(hi_calloc(elements, sizeof(redisReply*)));
+				if (!reply->element)
+				{
+					hi_free(reply);
+					return nullptr;
+				}
+			}
+			reply->elements = elements;
+			AttachToParent(task, reply);
+			return reply;
+		}
+
+		void* CreateInteger(const redisReadTask* task, long long value)
+		{
+			redisReply* reply = CreateReply(task);
+			if (!reply)
+			{
+				return nullptr;
+			}
+			reply->integer = value;
+			AttachToParent(task, reply);
+			return reply;
+		}
+
+		void* CreateDouble(const redisReadTask* task, double value, char* str, size_t len)
+		{
+			redisReply* reply = CreateReply(task);
+			if (!reply)
+			{
+				return nullptr;
+			}
+
+			// 元の文字列表現も保持する（hiredis と同じ）
+			auto* buf = static_cast<char*>(hi_malloc(len + 1));
+			if (!buf)
+			{
+				hi_free(reply);
+				return nullptr;
+			}
+			std::memcpy(buf, str, len);
+			buf[len] = '\0';
+
+			reply->dval = value;
+			reply->str = buf;
+			reply->len = len;
+			AttachToParent(task, reply);
+			return reply;
+		}
+
+		void* CreateNil(const redisReadTask* task)
+		{
+			redisReply* reply = CreateReply(task);
+			if (!reply)
+			{
+				return nullptr;
+			}
+			AttachToParent(task, reply);
+			return reply;
+		}
+
+		void* CreateBool(const redisReadTask* task, int value)
+		{
+			redisReply* reply = CreateReply(task);
+			if (!reply)
+			{
+				return nullptr;
+			}
+			reply->integer = (value != 0);
+			AttachToParent(task, reply);
+			return reply;
+		}
+
+		void FreeObject(void* obj)
+		{
+			auto* reply = static_cast<redisReply*>(obj);
+			if (!reply || reply == &g_decodedPayload)
+			{
+				return;
+			}
+
+			switch (reply->type)
+			{
+			case REDIS_REPLY_ARRAY:
+			case REDIS_REPLY_MAP:
+			case REDIS_REPLY_ATTR:
+			case REDIS_REPLY_SET:
+			case REDIS_REPLY_PUSH:
+				for (size_t i = 0; i < reply->elements; ++i)
+				{
+					FreeObject(reply->element[i]);
+				}
+				hi_free(reply->element);
+				break;
+			case REDIS_REPLY_ERROR:
+			case REDIS_REPLY_STATUS:
+			case REDIS_REPLY_STRING:
+			case REDIS_REPLY_DOUBLE:
+			case REDIS_REPLY_VERB:
+			case REDIS_REPLY_BIGNUM:
+				hi_free(reply->str);
+				break;
+			default:
+				break;
+			}
+			hi_free(reply);
+		}
+
+		redisReplyObjectFunctions g_messageReaderFunctions{
+			.createString = CreateString,
+			.createArray = CreateArray,
+			.createInteger = CreateInteger,
+			.createDouble = CreateDouble,
+			.createNil = CreateNil,
+			.createBool = CreateBool,
+			.freeObject = FreeObject,
+		};
+	}
+
+	void InstallMessageReader(redisContext& context, const RedisMessageHandler* handler)
+	{
+		// 読み取りタスクには reader->privdata が引き継がれる
+		context.reader->fn = &g_messageReaderFunctions;
+		context.reader->privdata = const_cast<RedisMessageHandler*>(handler);
+	}
+
+	bool IsDecodedPayload(const redisReply* reply) noexcept
+	{
+		return reply == &g_decodedPayload;
+	}
+}
@@ -0,0 +1,25 @@
+﻿#pragma once
+
+extern "C" {
+#include <hiredis/hiredis.h>
+}
+
+#include <functional>
+#include <string_view>
+
+namespace MessageBus
+{
+	/// @brief 購読メッセージを受け取るコールバック
+	/// @remark pattern はパターン購読（pmessage）の場合のみ空でない値になります
+	/// @remark 引数はリーダーのバッファを指しており、呼び出し中のみ有効です
+	using RedisMessageHandler = std::function<void(std::string_view pattern, std::string_view channel, std::string_view payload)>;
+
+	/// @brief 購読メッセージ（message / smessage / pmessage）のペイロードを redisReply を作らずに handler へ渡すリーダーを設定します
+	/// @param context 設定先のコンテキスト（応答の読み取りを開始する前に呼び出してください）
+	/// @param handler 呼び出すコールバック（context より長く生存する必要があります）
+	void InstallMessageReader(redisContext& context, const RedisMessageHandler* handler);
+
+	/// @brief リーダーが直接デコードしたペイロード要素（中身は空）かを返します
+	[[nodiscard]]
+	bool IsDecodedPayload(const redisReply* reply) noexcept;
+}
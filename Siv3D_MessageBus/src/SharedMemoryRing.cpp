@@ -0,0 +1,419 @@
+﻿#include "SharedMemoryRing.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#if defined(_WIN32)
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	include <Windows.h>
+#else
+#	include <cerrno>
+#	include <fcntl.h>
+#	include <signal.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace MessageBus
+{
+	namespace
+	{
+		// "MBSR"
+		constexpr std::uint32_t RING_MAGIC = 0x4D425352;
+		// 2: 書き込みが1周前のスロットの値を確かめてから取得する
+		// 3: 書き込み中のスロットに書き込み元のプロセスを記録する
+		constexpr std::uint32_t RING_VERSION = 3;
+
+		// 他のプロセスがセグメントを作り終えるまで待つ最大時間
+		constexpr auto OPEN_TIMEOUT = std::chrono::seconds{ 1 };
+		constexpr auto OPEN_RETRY_INTERVAL = std::chrono::milliseconds{ 1 };
+
+		// 読み込み側が、書き込み中のまま止まったスロットを読み飛ばすまでの時間
+		constexpr auto STALL_TIMEOUT = std::chrono::milliseconds{ 50 };
+
+		constexpr std::size_t RoundUp(std::size_t value, std::size_t alignment) noexcept
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	SharedMemoryRing::SharedMemoryRing(std::string_view name, std::size_t slotCount, std::size_t slotSize)
+	{
+		const std::uint64_t count = std::bit_ceil(std::max<std::size_t>(slotCount, 2));
+		const std::uint64_t stride = RoundUp(sizeof(SlotHeader) + std::max<std::size_t>(slotSize, 1), SLOT_ALIGNMENT);
+		const std::size_t size = sizeof(Header) + static_cast<std::size_t>(count * stride);
+
+		bool created = false;
+		if (not map(name, size, created))
+		{
+			return;
+		}
+
+		Header* header = reinterpret_cast<Header*>(m_base);
+		std::atomic_ref<std::uint32_t> magic{ header->magic };
+
+		if (created)
+		{
+			// 新しいセグメントは 0 で埋められている
+			header->version = RING_VERSION;
+			header->slotCount = count;
+			header->slotStride = stride;
+			magic.store(RING_MAGIC, std::memory_order_release);
+		}
+		else
+		{
+			const auto deadline = std::chrono::steady_clock::now() + OPEN_TIMEOUT;
+			while (magic.load(std::memory_order_acquire) != RING_MAGIC)
+			{
+				if (deadline <= std::chrono::steady_clock::now())
+				{
+					m_error = "Shared memory error: segment was not initialized";
+					unmap();
+					return;
+				}
+				std::this_thread::sleep_for(OPEN_RETRY_INTERVAL);
+			}
+
+			if (header->version != RING_VERSION ||
+				header->slotCount != count ||
+				header->slotStride != stride)
+			{
+				m_error = "Shared memory error: segment exists with a different slot count or slot size";
+				unmap();
+				return;
+			}
+		}
+
+		m_header = header;
+		m_slots = m_base + sizeof(Header);
+
+		// 開いた時点より後に書き込まれたものから読む
+		m_readIndex = std::atomic_ref<std::uint64_t>{ m_header->writeIndex }.load(std::memory_order_acquire);
+	}
+
+	SharedMemoryRing::~SharedMemoryRing()
+	{
+		unmap();
+	}
+
+	SharedMemoryRing::WriteResult SharedMemoryRing::write(std::string_view channel, std::string_view payload)
+	{
+		if (not m_header ||
+			dataCapacity() < channel.size() + payload.size())
+		{
+			return WriteResult::Failed;
+		}
+
+		const std::uint64_t ticket = std::atomic_ref<std::uint64_t>{ m_header->writeIndex }.fetch_add(1, std::memory_order_acq_rel);
+		SlotHeader* slot = slotAt(ticket);
+		std::atomic_ref<std::uint64_t> sequence{ slot->sequence };
+		const std::uint64_t claimed = ticket * 2 + 1;
+
+		// スロットには1周前のチケットの書き込み後の値が入っているはず（最初の1周は 0）
+		const std::uint64_t previous = (ticket < m_header->slotCount) ? 0 : (ticket - m_header->slotCount) * 2 + 2;
+		std::uint64_t current = sequence.load(std::memory_order_acquire);
+		if (current != previous)
+		{
+			// 遅れている間に1周後の書き込みがスロットを取った: 新しい値を古い値で上書きしない
+			if (claimed <= current)
+			{
+				return WriteResult::Dropped;
+			}
+
+			// 前の周の書き込みが終わっていない。止まっているだけの書き込みと内容が混ざらないよう、
+			// 書き込み元のプロセスが終了していることを確かめられた場合のみ引き継ぐ
+			if ((current & 1) && not IsAbandoned(slot, current))
+			{
+				return WriteResult::Dropped;
+			}
+		}
+
+		// 読み込み側が書き込み中の内容を使わないよう、先に奇数にしてから書き込む（他の書き込みに取られた場合は諦める）
+		if (not sequence.compare_exchange_strong(current, claimed, std::memory_order_acq_rel, std::memory_order_relaxed))
+		{
+			return WriteResult::Dropped;
+		}
+		std::atomic_ref<std::uint32_t>{ slot->ownerProcess }.store(CurrentProcessId(), std::memory_order_relaxed);
+		std::atomic_ref<std::uint64_t>{ slot->ownerSequence }.store(claimed, std::memory_order_release);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		slot->channelSize = static_cast<std::uint32_t>(channel.size());
+		slot->payloadSize = static_cast<std::uint32_t>(payload.size());
+		std::byte* data = reinterpret_cast<std::byte*>(slot + 1);
+		std::memcpy(data, channel.data(), channel.size());
+		std::memcpy(data + channel.size(), payload.data(), payload.size());
+
+		// 書き込み中に（このプロセスが終了したと誤って判断されて）引き継がれていた場合は、新しい書き込みの値を残す
+		std::uint64_t expected = claimed;
+		return sequence.compare_exchange_strong(expected, claimed + 1, std::memory_order_release, std::memory_order_relaxed)
+			? WriteResult::Written
+			: WriteResult::Dropped;
+	}
+
+	bool SharedMemoryRing::next(std::string_view& channel, std::string_view& payload)
+	{
+		if (not m_header)
+		{
+			return false;
+		}
+
+		for (;;)
+		{
+			const std::uint64_t ticket = m_readIndex;
+			SlotHeader* slot = slotAt(ticket);
+			std::atomic_ref<std::uint64_t> sequence{ slot->sequence };
+			const std::uint64_t expected = ticket * 2 + 2;
+
+			const std::uint64_t before = sequence.load(std::memory_order_acquire);
+			if (before < expected)
+			{
+				const std::uint64_t head = std::atomic_ref<std::uint64_t>{ m_header->writeIndex }.load(std::memory_order_acquire);
+				if (head <= ticket)
+				{
+					// まだ書き込まれていない
+					return false;
+				}
+
+				if (head - ticket <= m_header->slotCount)
+				{
+					// 書き込み中。書き込んだプロセスが終了して止まったままの場合は読み飛ばす
+					if (not stalledFor(ticket))
+					{
+						return false;
+					}
+					++m_dropped;
+					++m_readIndex;
+					continue;
+				}
+
+				// 書き込みが終わらないうちに1周以上追い越された: 下で読み飛ばす
+			}
+			else if (before == expected)
+			{
+				const std::size_t channelSize = slot->channelSize;
+				const std::size_t payloadSize = slot->payloadSize;
+				if (channelSize + payloadSize <= dataCapacity())
+				{
+					const char* data = reinterpret_cast<const char*>(slot + 1);
+					m_buffer.assign(data, channelSize + payloadSize);
+				}
+
+				// コピーしている間に上書きされていなければ確定
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (sequence.load(std::memory_order_relaxed) == expected &&
+					channelSize + payloadSize <= dataCapacity())
+				{
+					++m_readIndex;
+					channel = std::string_view{ m_buffer }.substr(0, channelSize);
+					payload = std::string_view{ m_buffer }.substr(channelSize);
+					return true;
+				}
+			}
+
+			// 追い越された: 残っている中で最も古いものまで進める
+			const std::uint64_t head = std::atomic_ref<std::uint64_t>{ m_header->writeIndex }.load(std::memory_order_acquire);
+			const std::uint64_t oldest = (m_header->slotCount < head) ? (head - m_header->slotCount) : 0;
+			const std::uint64_t resume = std::max(oldest, ticket + 1);
+			m_dropped += resume - ticket;
+			m_readIndex = resume;
+		}
+	}
+
+	bool SharedMemoryRing::stalledFor(const std::uint64_t ticket)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		if (m_stallTicket != ticket)
+		{
+			m_stallTicket = ticket;
+			m_stallSince = now;
+			return false;
+		}
+		return (STALL_TIMEOUT <= now - m_stallSince);
+	}
+
+	bool SharedMemoryRing::IsAbandoned(SlotHeader* slot, const std::uint64_t sequence) noexcept
+	{
+		// 書き込み元を記録する前であれば、まだ書き込んでいる途中
+		if (std::atomic_ref<std::uint64_t>{ slot->ownerSequence }.load(std::memory_order_acquire) != sequence)
+		{
+			return false;
+		}
+		return not IsProcessAlive(std::atomic_ref<std::uint32_t>{ slot->ownerProcess }.load(std::memory_order_relaxed));
+	}
+
+	SharedMemoryRing::SlotHeader* SharedMemoryRing::slotAt(std::uint64_t ticket) const noexcept
+	{
+		const std::uint64_t index = ticket & (m_header->slotCount - 1);
+		return reinterpret_cast<SlotHeader*>(m_slots + index * m_header->slotStride);
+	}
+
+	std::size_t SharedMemoryRing::dataCapacity() const noexcept
+	{
+		return static_cast<std::size_t>(m_header->slotStride) - sizeof(SlotHeader);
+	}
+
+#if defined(_WIN32)
+
+	std::uint32_t SharedMemoryRing::CurrentProcessId() noexcept
+	{
+		return static_cast<std::uint32_t>(::GetCurrentProcessId());
+	}
+
+	bool SharedMemoryRing::IsProcessAlive(const std::uint32_t processId) noexcept
+	{
+		HANDLE process = ::OpenProcess(SYNCHRONIZE, FALSE, processId);
+		if (not process)
+		{
+			// 存在しない ID は ERROR_INVALID_PARAMETER になる
+			return (::GetLastError() != ERROR_INVALID_PARAMETER);
+		}
+
+		// 終了していてもハンドルが残っている間は開けるため、シグナル状態も確かめる
+		const bool alive = (::WaitForSingleObject(process, 0) == WAIT_TIMEOUT);
+		::CloseHandle(process);
+		return alive;
+	}
+
+	bool SharedMemoryRing::map(std::string_view name, std::size_t size, bool& created)
+	{
+		std::wstring wideName = L"Local\\";
+		const int length = ::MultiByteToWideChar(CP_UTF8, 0, name.data(), static_cast<int>(name.size()), nullptr, 0);
+		const std::size_t offset = wideName.size();
+		wideName.resize(offset + length);
+		::MultiByteToWideChar(CP_UTF8, 0, name.data(), static_cast<int>(name.size()), wideName.data() + offset, length);
+		std::replace(wideName.begin() + offset, wideName.end(), L'\\', L'_');
+
+		const std::uint64_t size64 = size;
+		HANDLE mapping = ::CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+			static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), wideName.c_str());
+		if (not mapping)
+		{
+			m_error = "Shared memory error: CreateFileMapping failed (" + std::to_string(::GetLastError()) + ")";
+			return false;
+		}
+		created = (::GetLastError() != ERROR_ALREADY_EXISTS);
+
+		void* view = ::MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+		if (not view)
+		{
+			// 既存のセグメントが小さい場合もここで失敗する
+			m_error = "Shared memory error: MapViewOfFile failed (" + std::to_string(::GetLastError()) + ")";
+			::CloseHandle(mapping);
+			return false;
+		}
+
+		m_mapping = mapping;
+		m_base = static_cast<std::byte*>(view);
+		m_mappedSize = size;
+		return true;
+	}
+
+	void SharedMemoryRing::unmap() noexcept
+	{
+		if (m_base)
+		{
+			::UnmapViewOfFile(m_base);
+		}
+		if (m_mapping)
+		{
+			::CloseHandle(static_cast<HANDLE>(m_mapping));
+		}
+		m_base = nullptr;
+		m_header = nullptr;
+		m_slots = nullptr;
+		m_mapping = nullptr;
+		m_mappedSize = 0;
+	}
+
+#else
+
+	std::uint32_t SharedMemoryRing::CurrentProcessId() noexcept
+	{
+		return static_cast<std::uint32_t>(::getpid());
+	}
+
+	bool SharedMemoryRing::IsProcessAlive(const std::uint32_t processId) noexcept
+	{
+		// 権限が無い（EPERM）場合も存在はしている
+		return (::kill(static_cast<pid_t>(processId), 0) == 0) || (errno != ESRCH);
+	}
+
+	bool SharedMemoryRing::map(std::string_view name, std::size_t size, bool& created)
+	{
+		// POSIX の共有メモリ名は '/' で始まり、それ以外に '/' を含められない
+		std::string path = "/";
+		path += name;
+		std::replace(path.begin() + 1, path.end(), '/', '_');
+
+		int fd = ::shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+		created = (0 <= fd);
+		if (created)
+		{
+			if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+			{
+				m_error = "Shared memory error: ftruncate failed (" + std::to_string(errno) + ")";
+				::close(fd);
+				::shm_unlink(path.c_str());
+				return false;
+			}
+		}
+		else
+		{
+			if (errno != EEXIST ||
+				(fd = ::shm_open(path.c_str(), O_RDWR, 0666)) < 0)
+			{
+				m_error = "Shared memory error: shm_open failed (" + std::to_string(errno) + ")";
+				return false;
+			}
+
+			// 作成したプロセスが ftruncate するまで待つ
+			const auto deadline = std::chrono::steady_clock::now() + OPEN_TIMEOUT;
+			struct stat st{};
+			while (::fstat(fd, &st) == 0 && st.st_size == 0 && std::chrono::steady_clock::now() < deadline)
+			{
+				std::this_thread::sleep_for(OPEN_RETRY_INTERVAL);
+			}
+			if (static_cast<std::size_t>(st.st_size) != size)
+			{
+				m_error = "Shared memory error: segment exists with a different slot count or slot size";
+				::close(fd);
+				return false;
+			}
+		}
+
+		void* view = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED)
+		{
+			m_error = "Shared memory error: mmap failed (" + std::to_string(errno) + ")";
+			return false;
+		}
+
+		m_base = static_cast<std::byte*>(view);
+		m_mappedSize = size;
+		return true;
+	}
+
+	void SharedMemoryRing::unmap() noexcept
+	{
+		if (m_base)
+		{
+			::munmap(m_base, m_mappedSize);
+		}
+		m_base = nullptr;
+		m_header = nullptr;
+		m_slots = nullptr;
+		m_mappedSize = 0;
+	}
+
+#endif
+}
@@ -0,0 +1,137 @@
+﻿#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace MessageBus
+{
+	/// @brief 同じマシン上のプロセス間で共有する、名前付き共有メモリ上のリングバッファ
+	/// @remark 書き込みは任意のプロセス・スレッドから行えます。読み込みはインスタンスごとのカーソルで行い、全てのメッセージを受け取ります
+	/// @remark 読み込みが1周以上遅れた場合、追い越されたメッセージは破棄されます（dropped() で数を取得できます）
+	/// @remark 書き込みが一定時間終わらないスロットは読み飛ばされます。書き込んだプロセスが終了している場合に限り、次の周の書き込みがスロットを引き継ぎます
+	/// @remark セグメントは削除せずに残すため、後から開いたプロセスも同じ名前で参加できます
+	class SharedMemoryRing
+	{
+	public:
+
+		/// @brief write() の結果
+		enum class WriteResult
+		{
+			/// @brief 書き込みました
+			Written,
+
+			/// @brief セグメントを開けていないか、1スロットに収まりません
+			Failed,
+
+			/// @brief スロットがまだ他の書き込みに使われているか、書き込み中に1周後の書き込みに追い越されたため破棄しました
+			Dropped,
+		};
+
+		/// @param name セグメント名（UTF-8）
+		/// @param slotCount スロット数（2 の累乗に切り上げます）
+		/// @param slotSize 1スロットの大きさ（チャンネル名とペイロードの合計の上限になります）
+		/// @remark 既に同じ名前のセグメントがある場合は、slotCount と slotSize が一致する必要があります
+		SharedMemoryRing(std::string_view name, std::size_t slotCount, std::size_t slotSize);
+
+		~SharedMemoryRing();
+
+		SharedMemoryRing(const SharedMemoryRing&) = delete;
+		SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+		/// @brief セグメントを開けた場合 true
+		[[nodiscard]]
+		bool isOpen() const noexcept { return m_header != nullptr; }
+
+		/// @brief セグメントを開けなかった理由（UTF-8）
+		[[nodiscard]]
+		const std::string& error() const noexcept { return m_error; }
+
+		/// @brief メッセージを書き込みます（任意のスレッドから呼び出し可能）
+		/// @remark 書き込み中のまま残っているスロットは、書き込んだプロセスが終了している場合にのみ上書きします
+		WriteResult write(std::string_view channel, std::string_view payload);
+
+		/// @brief 次のメッセージを読み込みます（読み込みを行うスレッドのみが呼び出せます）
+		/// @param channel チャンネル名（次の呼び出しまで有効）
+		/// @param payload ペイロード（次の呼び出しまで有効）
+		/// @return 新しいメッセージが無い場合 false
+		bool next(std::string_view& channel, std::string_view& payload);
+
+		/// @brief 追い越されて読めなかったメッセージの累計
+		[[nodiscard]]
+		std::uint64_t dropped() const noexcept { return m_dropped; }
+
+	private:
+
+		friend class SharedMemoryRingTest;
+
+		// スロットはキャッシュラインの倍数に揃える
+		static constexpr std::size_t SLOT_ALIGNMENT = 64;
+
+		struct Header
+		{
+			// 作成したプロセスが他のフィールドを書き終えてから立てる
+			std::uint32_t magic;
+			std::uint32_t version;
+			std::uint64_t slotCount;
+			std::uint64_t slotStride;
+
+			// 次に書き込むチケット番号（書き込み側で共有するため、読み込み用のフィールドとキャッシュラインを分ける）
+			alignas(SLOT_ALIGNMENT) std::uint64_t writeIndex;
+		};
+
+		struct SlotHeader
+		{
+			// チケット番号 t の書き込み中は 2t+1、書き込み後は 2t+2（0 は未使用）
+			std::uint64_t sequence;
+
+			// 書き込み元のプロセス（ownerSequence が sequence と一致する場合のみ有効）
+			std::uint64_t ownerSequence;
+			std::uint32_t ownerProcess;
+
+			std::uint32_t channelSize;
+			std::uint32_t payloadSize;
+		};
+
+		static std::uint32_t CurrentProcessId() noexcept;
+
+		// 存在が確かめられない場合（権限が無いなど）も true
+		static bool IsProcessAlive(std::uint32_t processId) noexcept;
+
+		// sequence が奇数のまま残っているスロットの書き込み元が終了している場合 true
+		static bool IsAbandoned(SlotHeader* slot, std::uint64_t sequence) noexcept;
+
+		SlotHeader* slotAt(std::uint64_t ticket) const noexcept;
+
+		std::size_t dataCapacity() const noexcept;
+
+		bool map(std::string_view name, std::size_t size, bool& created);
+
+		void unmap() noexcept;
+
+		// マッピングの先頭（ヘッダの検証が終わるまで m_header は null のまま）
+		std::byte* m_base = nullptr;
+		Header* m_header = nullptr;
+		std::byte* m_slots = nullptr;
+		std::size_t m_mappedSize = 0;
+
+		// 読み込み側のカーソル（開いた時点の書き込み位置から始める）
+		std::uint64_t m_readIndex = 0;
+		std::uint64_t m_dropped = 0;
+
+		// 書き込みが終わらないまま待っているチケットと、待ち始めた時刻
+		std::uint64_t m_stallTicket = UINT64_MAX;
+		std::chrono::steady_clock::time_point m_stallSince;
+
+		// チケットの書き込みを待ち始めてから STALL_TIMEOUT を過ぎた場合 true
+		bool stalledFor(std::uint64_t ticket);
+
+		// next() で返す領域（書き込みと競合しても壊れないよう、スロットからコピーしてから検証する）
+		std::string m_buffer;
+		std::string m_error;
+
+		// Windows ではファイルマッピングのハンドル
+		void* m_mapping = nullptr;
+	};
+}
@@ -0,0 +1,217 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <Siv3D/Array.hpp>
+#include <Siv3D/HashTable.hpp>
+
+namespace MessageBus
+{
+	/// @brief '/' 区切りのトピックパターンを事前に木構造へまとめ、トピックに一致するパターンを列挙します
+	/// @remark パターンの各階層は、リテラル・"*"（任意の1階層）・末尾の "**"（残りの1階層以上）のいずれかです
+	/// @remark 照合のコストはパターン数ではなくトピックの階層数に比例します
+	class TopicTrie
+	{
+	public:
+		/// @brief パターンとして有効かを返します（空の階層や、末尾以外の "**" は無効）
+		[[nodiscard]]
+		static bool IsValidPattern(std::string_view pattern)
+		{
+			if (pattern.empty())
+			{
+				return false;
+			}
+
+			for (size_t begin = 0;;)
+			{
+				const size_t end = pattern.find('/', begin);
+				const std::string_view segment = pattern.substr(begin, end - begin);
+				if (segment.empty())
+				{
+					return false;
+				}
+				if (segment == "**" && end != std::string_view::npos)
+				{
+					return false;
+				}
+				if (end == std::string_view::npos)
+				{
+					return true;
+				}
+				begin = end + 1;
+			}
+		}
+
+		/// @brief パターンを PSUBSCRIBE 用の glob に変換します
+		/// @remark glob の "*" は '/' にも一致するため、Redis からは一致するものより広く届きます（照合で絞り込みます）
+		[[nodiscard]]
+		static std::string ToRedisGlob(std::string_view pattern)
+		{
+			std::string glob;
+			glob.reserve(pattern.size());
+
+			for (size_t begin = 0;;)
+			{
+				const size_t end = pattern.find('/', begin);
+				const std::string_view segment = pattern.substr(begin, end - begin);
+				if (segment == "*" || segment == "**")
+				{
+					glob += '*';
+				}
+				else
+				{
+					for (const char ch : segment)
+					{
+						// glob の特殊文字はエスケープする
+						if (ch == '*' || ch == '?' || ch == '[' || ch == ']' || ch == '\\')
+						{
+							glob += '\\';
+						}
+						glob += ch;
+					}
+				}
+
+				if (end == std::string_view::npos)
+				{
+					return glob;
+				}
+				glob += '/';
+				begin = end + 1;
+			}
+		}
+
+		/// @brief 全てのパターンを削除します
+		void clear()
+		{
+			m_nodes.clear();
+		}
+
+		/// @brief パターンを登録します（IsValidPattern() で検証済みであること）
+		/// @param id 一致したときに返す値
+		void insert(std::string_view pattern, std::uint32_t id)
+		{
+			if (m_nodes.isEmpty())
+			{
+				m_nodes.emplace_back();
+			}
+
+			std::uint32_t node = 0;
+			for (size_t begin = 0;;)
+			{
+				const size_t end = pattern.find('/', begin);
+				const std::string_view segment = pattern.substr(begin, end - begin);
+
+				if (segment == "**")
+				{
+					m_nodes[node].restIds.push_back(id);
+					return;
+				}
+
+				node = child(node, segment);
+
+				if (end == std::string_view::npos)
+				{
+					m_nodes[node].ids.push_back(id);
+					return;
+				}
+				begin = end + 1;
+			}
+		}
+
+		/// @brief topic に一致するパターンの値を列挙します
+		/// @param callback 一致したパターンごとに callback(id) が呼ばれます
+		template <class Callback>
+		void match(std::string_view topic, Callback&& callback) const
+		{
+			if (m_nodes.isEmpty())
+			{
+				return;
+			}
+			matchFrom(0, topic, 0, callback);
+		}
+
+	private:
+		static constexpr std::uint32_t NoNode = UINT32_MAX;
+
+		struct Node
+		{
+			// リテラルの階層
+			s3d::HashTable<std::string, std::uint32_t> children;
+
+			// "*" の階層
+			std::uint32_t wildcard = NoNode;
+
+			// ここで終わるパターン
+			s3d::Array<std::uint32_t> ids;
+
+			// ここから先の "**" で終わるパターン
+			s3d::Array<std::uint32_t> restIds;
+		};
+
+		s3d::Array<Node> m_nodes;
+
+		std::uint32_t child(std::uint32_t node, std::string_view segment)
+		{
+			if (segment == "*")
+			{
+				if (m_nodes[node].wildcard == NoNode)
+				{
+					m_nodes[node].wildcard = static_cast<std::uint32_t>(m_nodes.size());
+					m_nodes.emplace_back();
+				}
+				return m_nodes[node].wildcard;
+			}
+
+			if (auto it = m_nodes[node].children.find(segment); it != m_nodes[node].children.end())
+			{
+				return it->second;
+			}
+
+			const auto next = static_cast<std::uint32_t>(m_nodes.size());
+			m_nodes[node].children.emplace(std::string{ segment }, next);
+			m_nodes.emplace_back();
+			return next;
+		}
+
+		template <class Callback>
+		void matchFrom(std::uint32_t node, std::string_view topic, size_t begin, Callback& callback) const
+		{
+			const Node& current = m_nodes[node];
+
+			// 残りが1階層以上あれば "**" に一致する
+			for (const auto id : current.restIds)
+			{
+				callback(id);
+			}
+
+			const size_t end = topic.find('/', begin);
+			const std::string_view segment = topic.substr(begin, end - begin);
+			const bool last = (end == std::string_view::npos);
+
+			const auto visit = [&](std::uint32_t next)
+			{
+				if (last)
+				{
+					for (const auto id : m_nodes[next].ids)
+					{
+						callback(id);
+					}
+				}
+				else
+				{
+					matchFrom(next, topic, end + 1, callback);
+				}
+			};
+
+			if (auto it = current.children.find(segment); it != current.children.end())
+			{
+				visit(it->second);
+			}
+
+			if (current.wildcard != NoNode)
+			{
+				visit(current.wildcard);
+			}
+		}
+	};
+}
@@ -0,0 +1,595 @@
+﻿#include "RedisDockerTestFixture.hpp"
+#include <MessageBus/MessageBus.hpp>
+#include "Utility.hpp"
+#include <hiredis/alloc.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// ============================================================================
+// ヒープ確保回数の計測
+// operator new は置き換えるが、数えるのは HeapAllocationCounter が生存している間のみ
+// ============================================================================
+
+namespace
+{
+	std::atomic<bool> g_countHeapAllocations{ false };
+	std::atomic<size_t> g_heapAllocations{ 0 };
+
+	// 生存している間の operator new の呼び出し回数を数える（同時に1つだけ使う）
+	class HeapAllocationCounter
+	{
+	public:
+
+		HeapAllocationCounter()
+		{
+			g_heapAllocations.store(0, std::memory_order_relaxed);
+			g_countHeapAllocations.store(true, std::memory_order_relaxed);
+		}
+
+		~HeapAllocationCounter()
+		{
+			g_countHeapAllocations.store(false, std::memory_order_relaxed);
+		}
+
+		HeapAllocationCounter(const HeapAllocationCounter&) = delete;
+		HeapAllocationCounter& operator=(const HeapAllocationCounter&) = delete;
+
+		[[nodiscard]]
+		size_t count() const noexcept { return g_heapAllocations.load(std::memory_order_relaxed); }
+	};
+}
+
+void* operator new(std::size_t size)
+{
+	if (g_countHeapAllocations.load(std::memory_order_relaxed))
+	{
+		g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (void* p = std::malloc(size ? size : 1))
+	{
+		return p;
+	}
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+// ============================================================================
+// MessageBus ベンチマーク
+// 結果は標準出力と gtest のプロパティ（--gtest_output=xml）に出力される
+// 時間がかかるため通常のテストでは実行しない（--gtest_also_run_disabled_tests --gtest_filter=*Benchmark* で実行する）
+// ============================================================================
+
+class MessageBusBenchmark : public RedisDocker
+{
+protected:
+	static void SetUpTestSuite()
+	{
+		RedisDocker::SetUpTestSuite();
+		StartContainer();
+	}
+
+	static void TearDownTestSuite()
+	{
+		RedisDocker::TearDownTestSuite();
+	}
+
+	static void Report(const std::string& name, double value, const char* unit)
+	{
+		std::cout << "[ BENCH    ] " << name << ": " << value << ' ' << unit << std::endl;
+		::testing::Test::RecordProperty(name, std::to_string(value));
+	}
+};
+
+namespace
+{
+	// emitsPerFrame 件ずつ totalEvents 件を emit し、受信側に全件届くまでの events/sec を返す
+	double MeasureEmitThroughput(const MessageBus::MessageBusOptions& options, StringView channel, size_t totalEvents, size_t emitsPerFrame)
+	{
+		MessageBus::MessageBus sender{ options };
+		MessageBus::MessageBus receiver{ MessageBus::MessageBusOptions{
+			.ip = U"127.0.0.1",
+			.port = 6379,
+			.unixSocket = options.unixSocket,
+			.transport = options.transport,
+			.sharedMemoryName = options.sharedMemoryName,
+			.sharedMemorySlotCount = options.sharedMemorySlotCount,
+		} };
+		receiver.subscribe(channel);
+
+		WaitForConnection(sender, 10s);
+		WaitForConnection(receiver, 10s);
+		Sleep(receiver, 0.5s);
+
+		const JSON payload = UR"({ "x": 1.5, "y": -2.25, "id": 12345 })"_json;
+
+		size_t sent = 0;
+		size_t received = 0;
+		Stopwatch sw{ StartImmediately::Yes };
+		while (received < totalEvents && sw < 30s)
+		{
+			for (size_t i = 0; i < emitsPerFrame && sent < totalEvents; ++i)
+			{
+				if (sender.emit(channel, payload))
+				{
+					++sent;
+				}
+			}
+			sender.tick();
+			receiver.tick();
+			received += receiver.events().size();
+		}
+
+		EXPECT_EQ(received, totalEvents);
+		return received / sw.sF();
+	}
+}
+
+namespace
+{
+	// 1件ずつ emit し、受信側の events() に現れるまでの時間の中央値をマイクロ秒で返す
+	double MeasureEmitLatency(const MessageBus::MessageBusOptions& options, StringView channel, size_t samples)
+	{
+		MessageBus::MessageBus sender{ options };
+		MessageBus::MessageBus receiver{ options };
+		receiver.subscribe(channel);
+
+		WaitForConnection(sender, 10s);
+		WaitForConnection(receiver, 10s);
+		Sleep(receiver, 0.5s);
+
+		const JSON payload = UR"({ "x": 1.5, "y": -2.25, "id": 12345 })"_json;
+
+		Array<double> latencies;
+		for (size_t i = 0; i < samples; ++i)
+		{
+			const Stopwatch sw{ StartImmediately::Yes };
+			if (not sender.emit(channel, payload))
+			{
+				continue;
+			}
+
+			bool received = false;
+			while (not received && sw < 1s)
+			{
+				sender.tick();
+				receiver.tick();
+				received = (not receiver.events().isEmpty());
+			}
+			if (received)
+			{
+				latencies.push_back(sw.sF() * 1e6);
+			}
+		}
+
+		EXPECT_EQ(latencies.size(), samples);
+		if (latencies.isEmpty())
+		{
+			return 0.0;
+		}
+		std::sort(latencies.begin(), latencies.end());
+		return latencies[latencies.size() / 2];
+	}
+}
+
+TEST_F(MessageBusBenchmark, DISABLED_BatchedPublishThroughput)
+{
+	constexpr size_t TotalEvents = 20000;
+	constexpr size_t EmitsPerFrame = 500;
+
+	const double perCommand = MeasureEmitThroughput(
+		{ .ip = U"127.0.0.1", .port = 6379, .batchedPublish = false },
+		U"bench/publish/single", TotalEvents, EmitsPerFrame);
+	const double batched = MeasureEmitThroughput(
+		{ .ip = U"127.0.0.1", .port = 6379, .batchedPublish = true },
+		U"bench/publish/batched", TotalEvents, EmitsPerFrame);
+
+	Report("publish_per_command_events_per_sec", perCommand, "events/s");
+	Report("publish_batched_events_per_sec", batched, "events/s");
+	Report("publish_batched_speedup", batched / perCommand, "x");
+}
+
+TEST_F(MessageBusBenchmark, DISABLED_FireAndForgetThroughput)
+{
+	constexpr size_t TotalEvents = 20000;
+	constexpr size_t EmitsPerFrame = 500;
+
+	const double acknowledged = MeasureEmitThroughput(
+		{ .ip = U"127.0.0.1", .port = 6379, .deliveryMode = MessageBus::DeliveryMode::Acknowledged },
+		U"bench/delivery/acknowledged", TotalEvents, EmitsPerFrame);
+	const double fireAndForget = MeasureEmitThroughput(
+		{ .ip = U"127.0.0.1", .port = 6379, .deliveryMode = MessageBus::DeliveryMode::FireAndForget },
+		U"bench/delivery/fire_and_forget", TotalEvents, EmitsPerFrame);
+
+	Report("delivery_acknowledged_events_per_sec", acknowledged, "events/s");
+	Report("delivery_fire_and_forget_events_per_sec", fireAndForget, "events/s");
+}
+
+TEST_F(MessageBusBenchmark, DISABLED_TickAllocationsPerEvent)
+{
+	constexpr size_t Frames = 200;
+	constexpr size_t EmitsPerFrame = 200;
+
+	MessageBus::MessageBus sender{ U"127.0.0.1", 6379 };
+	MessageBus::MessageBus receiver{ U"127.0.0.1", 6379 };
+	receiver.subscribe(U"bench/alloc");
+
+	WaitForConnection(sender, 10s);
+	WaitForConnection(receiver, 10s);
+	Sleep(receiver, 0.5s);
+
+	const JSON payload = UR"({ "x": 1.5, "y": -2.25, "id": 12345 })"_json;
+
+	size_t received = 0;
+	size_t allocations = 0;
+	for (size_t frame = 0; frame < Frames; ++frame)
+	{
+		for (size_t i = 0; i < EmitsPerFrame; ++i)
+		{
+			sender.emit(U"bench/alloc", payload);
+		}
+		sender.tick();
+		System::Sleep(1ms);
+
+		// 受信側 tick() の間に発生したヒープ確保のみを数える
+		{
+			const HeapAllocationCounter counter;
+			receiver.tick();
+			allocations += counter.count();
+		}
+
+		received += receiver.events().size();
+	}
+
+	ASSERT_GT(received, 0u);
+	Report("tick_received_events", static_cast<double>(received), "events");
+	Report("tick_heap_allocations_per_event", static_cast<double>(allocations) / received, "allocs/event");
+}
+
+// ============================================================================
+// hiredis の確保関数ごとのヒープ確保回数
+// 確保関数はプロセスで最初の接続で決まるため、既定の malloc / free とプールを
+// それぞれ新しいプロセスで計測する（DISABLED_PooledAllocatorBurst が HiredisAllocatorBurst を起動する）
+// ============================================================================
+
+namespace
+{
+	constexpr size_t AllocatorBurstSize = 100000;
+
+	// 起動されたプロセスへの指定（"default" / "pooled"）と結果の書き込み先
+	constexpr auto AllocatorModeVariable = U"MESSAGEBUS_BENCH_ALLOCATOR";
+	constexpr auto AllocatorResultVariable = U"MESSAGEBUS_BENCH_RESULT";
+
+	// 既定の確保関数で hiredis が malloc / calloc / realloc を呼んだ回数
+	std::atomic<uint64> g_hiredisHeapAllocations{ 0 };
+
+	void* CountingMalloc(size_t size)
+	{
+		g_hiredisHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+		return std::malloc(size);
+	}
+
+	void* CountingCalloc(size_t count, size_t size)
+	{
+		g_hiredisHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+		return std::calloc(count, size);
+	}
+
+	void* CountingRealloc(void* ptr, size_t size)
+	{
+		g_hiredisHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+		return std::realloc(ptr, size);
+	}
+
+	void PlainFree(void* ptr)
+	{
+		std::free(ptr);
+	}
+
+	char* CountingStrdup(const char* str)
+	{
+		const size_t length = std::strlen(str) + 1;
+		auto* copy = static_cast<char*>(CountingMalloc(length));
+		if (copy)
+		{
+			std::memcpy(copy, str, length);
+		}
+		return copy;
+	}
+
+	// burstSize 件を emit し全件受信する間に heapAllocations() が増えた数を返す
+	uint64 MeasureBurstAllocations(const MessageBus::MessageBusOptions& options, StringView channel, size_t burstSize, uint64(*heapAllocations)())
+	{
+		MessageBus::MessageBus sender{ options };
+		MessageBus::MessageBus receiver{ options };
+		receiver.subscribe(channel);
+
+		WaitForConnection(sender, 10s);
+		WaitForConnection(receiver, 10s);
+		Sleep(receiver, 0.5s);
+
+		const JSON payload = UR"({ "x": 1.5, "y": -2.25, "id": 12345 })"_json;
+		const uint64 before = heapAllocations();
+
+		size_t sent = 0;
+		size_t received = 0;
+		Stopwatch sw{ StartImmediately::Yes };
+		while (received < burstSize && sw < 60s)
+		{
+			for (size_t i = 0; i < 1000 && sent < burstSize; ++i)
+			{
+				if (sender.emit(channel, payload))
+				{
+					++sent;
+				}
+			}
+			sender.tick();
+			receiver.tick();
+			received += receiver.events().size();
+		}
+		EXPECT_EQ(received, burstSize);
+
+		return heapAllocations() - before;
+	}
+
+	// このテストバイナリを mode の確保関数で起動し、HiredisAllocatorBurst の結果を読み込む
+	JSON RunAllocatorBurst(const std::string& mode)
+	{
+		const String resultPath = FileSystem::TemporaryDirectoryPath() + U"siv3d-messagebus-allocator-" + Unicode::Widen(mode) + U".json";
+		FileSystem::Remove(resultPath);
+
+		bp::child c(
+			Unicode::ToUTF8(FileSystem::ModulePath()),
+			"--gtest_also_run_disabled_tests",
+			"--gtest_filter=HiredisAllocatorBurst.DISABLED_Measure",
+			bp::env[Unicode::ToUTF8(AllocatorModeVariable)] = mode,
+			bp::env[Unicode::ToUTF8(AllocatorResultVariable)] = Unicode::ToUTF8(resultPath)
+		);
+		c.wait();
+
+		return JSON::Load(resultPath);
+	}
+}
+
+// DISABLED_PooledAllocatorBurst から起動された場合のみ計測する
+TEST(HiredisAllocatorBurst, DISABLED_Measure)
+{
+	const String mode = EnvironmentVariable::Get(AllocatorModeVariable);
+	const String resultPath = EnvironmentVariable::Get(AllocatorResultVariable);
+	if (mode.isEmpty() || resultPath.isEmpty())
+	{
+		GTEST_SKIP() << "started by MessageBusBenchmark.DISABLED_PooledAllocatorBurst";
+	}
+
+	const bool pooled = (mode == U"pooled");
+	JSON result;
+	if (pooled)
+	{
+		const MessageBus::MessageBusOptions options{ .ip = U"127.0.0.1", .port = 6379, .pooledAllocator = true };
+		result[U"heapAllocations"] = MeasureBurstAllocations(options, U"bench/alloc/pooled", AllocatorBurstSize,
+			[]() { return MessageBus::MessageBus::allocatorStats().upstreamAllocations; });
+
+		const auto stats = MessageBus::MessageBus::allocatorStats();
+		ASSERT_NE(stats.allocations, 0u) << "pooled allocator was not installed";
+		result[U"hitRate"] = stats.hitRate();
+		result[U"peakBytesInUse"] = stats.peakBytesInUse;
+		result[U"peakReservedBytes"] = stats.peakReservedBytes;
+	}
+	else
+	{
+		// 既定の確保関数のままの hiredis の malloc を数えるため、最初の接続より前に数えるだけの関数を登録する
+		hiredisAllocFuncs funcs{
+			.mallocFn = CountingMalloc,
+			.callocFn = CountingCalloc,
+			.reallocFn = CountingRealloc,
+			.strdupFn = CountingStrdup,
+			.freeFn = PlainFree,
+		};
+		hiredisSetAllocators(&funcs);
+
+		const MessageBus::MessageBusOptions options{ .ip = U"127.0.0.1", .port = 6379 };
+		result[U"heapAllocations"] = MeasureBurstAllocations(options, U"bench/alloc/default", AllocatorBurstSize,
+			[]() { return g_hiredisHeapAllocations.load(std::memory_order_relaxed); });
+	}
+
+	ASSERT_TRUE(result.save(resultPath));
+}
+
+TEST_F(MessageBusBenchmark, DISABLED_PooledAllocatorBurst)
+{
+	const JSON defaultRun = RunAllocatorBurst("default");
+	const JSON pooledRun = RunAllocatorBurst("pooled");
+	ASSERT_TRUE(defaultRun) << "default allocator run did not produce a result";
+	ASSERT_TRUE(pooledRun) << "pooled allocator run did not produce a result";
+
+	const uint64 defaultAllocations = defaultRun[U"heapAllocations"].get<uint64>();
+	const uint64 pooledAllocations = pooledRun[U"heapAllocations"].get<uint64>();
+
+	Report("hiredis_default_heap_mallocs_per_message", static_cast<double>(defaultAllocations) / AllocatorBurstSize, "mallocs/msg");
+	Report("hiredis_pooled_heap_mallocs_per_message", static_cast<double>(pooledAllocations) / AllocatorBurstSize, "mallocs/msg");
+	Report("hiredis_heap_malloc_reduction", (1.0 - static_cast<double>(pooledAllocations) / defaultAllocations) * 100.0, "%");
+	Report("hiredis_pool_hit_rate", pooledRun[U"hitRate"].get<double>() * 100.0, "%");
+	Report("hiredis_peak_bytes_in_use", pooledRun[U"peakBytesInUse"].get<double>(), "bytes");
+	Report("hiredis_peak_reserved_bytes", pooledRun[U"peakReservedBytes"].get<double>(), "bytes");
+
+	EXPECT_LT(pooledAllocations, defaultAllocations);
+}
+
+namespace
+{
+	struct TelemetrySample
+	{
+		int32 id = 0;
+		int64 t = 0;
+		double x = 0.0;
+		double y = 0.0;
+		double z = 0.0;
+		Array<double> samples;
+
+		MESSAGEBUS_FIELDS(id, t, x, y, z, samples)
+	};
+}
+
+TEST_F(MessageBusBenchmark, DISABLED_PayloadCodecEncodeDecode)
+{
+	constexpr size_t Iterations = 20000;
+
+	// 数値中心のテレメトリ
+	JSON payload;
+	payload[U"id"] = 12345;
+	payload[U"t"] = 1718000000123;
+	payload[U"x"] = 1.5;
+	payload[U"y"] = -2.25;
+	payload[U"z"] = 0.1;
+	Array<JSON> samples;
+	for (int32 i = 0; i < 32; ++i)
+	{
+		samples << JSON(i * 0.5);
+	}
+	payload[U"samples"] = JSON(samples);
+
+	for (const auto format : { MessageBus::PayloadFormat::JSON, MessageBus::PayloadFormat::MessagePack })
+	{
+		const std::string name = (format == MessageBus::PayloadFormat::JSON) ? "json" : "msgpack";
+
+		std::string encoded;
+		Stopwatch encodeTime{ StartImmediately::Yes };
+		for (size_t i = 0; i < Iterations; ++i)
+		{
+			encoded.clear();
+			MessageBus::PayloadCodec::Encode(payload, format, encoded);
+		}
+		const double encodeNs = encodeTime.sF() * 1e9 / Iterations;
+
+		size_t decodedSize = 0;
+		Stopwatch decodeTime{ StartImmediately::Yes };
+		for (size_t i = 0; i < Iterations; ++i)
+		{
+			decodedSize += MessageBus::PayloadCodec::Decode(encoded).size();
+		}
+		const double decodeNs = decodeTime.sF() * 1e9 / Iterations;
+
+		EXPECT_EQ(MessageBus::PayloadCodec::Decode(encoded), payload);
+		EXPECT_EQ(decodedSize, payload.size() * Iterations);
+
+		Report("payload_" + name + "_bytes", static_cast<double>(encoded.size()), "bytes");
+		Report("payload_" + name + "_encode_ns", encodeNs, "ns/op");
+		Report("payload_" + name + "_decode_ns", decodeNs, "ns/op");
+
+		// 同じ内容を MESSAGEBUS_FIELDS の構造体から直接書き込む / 読み込む
+		const auto sample = MessageBus::PayloadCodec::DecodeValue<TelemetrySample>(encoded, [&]() { return MessageBus::PayloadCodec::Decode(encoded); });
+		ASSERT_TRUE(sample);
+
+		Stopwatch typedEncodeTime{ StartImmediately::Yes };
+		for (size_t i = 0; i < Iterations; ++i)
+		{
+			encoded.clear();
+			MessageBus::PayloadCodec::EncodeValue(*sample, format, encoded);
+		}
+		const double typedEncodeNs = typedEncodeTime.sF() * 1e9 / Iterations;
+
+		size_t typedSamples = 0;
+		Stopwatch typedDecodeTime{ StartImmediately::Yes };
+		for (size_t i = 0; i < Iterations; ++i)
+		{
+			// JSON テキストは DOM を経由するため、パースも計測に含める
+			if (const auto decoded = MessageBus::PayloadCodec::DecodeValue<TelemetrySample>(encoded, [&]() { return MessageBus::PayloadCodec::Decode(encoded); }))
+			{
+				typedSamples += decoded->samples.size();
+			}
+		}
+		const double typedDecodeNs = typedDecodeTime.sF() * 1e9 / Iterations;
+
+		EXPECT_EQ(typedSamples, sample->samples.size() * Iterations);
+
+		Report("payload_" + name + "_typed_encode_ns", typedEncodeNs, "ns/op");
+		Report("payload_" + name + "_typed_decode_ns", typedDecodeNs, "ns/op");
+	}
+}
+
+TEST_F(MessageBusBenchmark, DISABLED_SharedMemoryVersusRedis)
+{
+	constexpr size_t LatencySamples = 2000;
+	constexpr size_t TotalEvents = 20000;
+	constexpr size_t EmitsPerFrame = 500;
+
+	const MessageBus::MessageBusOptions redis{ .ip = U"127.0.0.1", .port = 6379 };
+	const MessageBus::MessageBusOptions sharedMemory{
+		.transport = MessageBus::Transport::SharedMemory,
+		.sharedMemoryName = U"MessageBusBenchmark_SharedMemory",
+		.sharedMemorySlotCount = 32768,
+	};
+
+	Report("latency_redis_median_us", MeasureEmitLatency(redis, U"bench/transport/latency", LatencySamples), "us");
+	Report("latency_shared_memory_median_us", MeasureEmitLatency(sharedMemory, U"bench/transport/latency", LatencySamples), "us");
+
+	const double redisThroughput = MeasureEmitThroughput(redis, U"bench/transport/throughput", TotalEvents, EmitsPerFrame);
+	const double sharedMemoryThroughput = MeasureEmitThroughput(sharedMemory, U"bench/transport/throughput", TotalEvents, EmitsPerFrame);
+	Report("throughput_redis_events_per_sec", redisThroughput, "events/s");
+	Report("throughput_shared_memory_events_per_sec", sharedMemoryThroughput, "events/s");
+	Report("throughput_shared_memory_speedup", sharedMemoryThroughput / redisThroughput, "x");
+}
+
+// ============================================================================
+// Unix ドメインソケットと TCP ループバックの比較
+// （POSIX 環境のみ。Windows で拒否されることは RedisConnectionTest で確かめる）
+// ============================================================================
+
+#if not defined(_WIN32)
+
+class MessageBusUnixSocketBenchmark : public MessageBusBenchmark
+{
+protected:
+	inline static String s_socketDir;
+
+	static void SetUpTestSuite()
+	{
+		RedisDocker::SetUpTestSuite();
+
+		s_socketDir = FileSystem::TemporaryDirectoryPath() + U"siv3d-messagebus-redis/";
+		FileSystem::CreateDirectories(s_socketDir);
+		StartUnixSocketContainer(Unicode::ToUTF8(s_socketDir));
+	}
+
+	static void TearDownTestSuite()
+	{
+		RedisDocker::TearDownTestSuite();
+	}
+};
+
+TEST_F(MessageBusUnixSocketBenchmark, DISABLED_UnixSocketVersusTcpLatency)
+{
+	constexpr size_t LatencySamples = 2000;
+	constexpr size_t TotalEvents = 20000;
+	constexpr size_t EmitsPerFrame = 500;
+
+	const String socketPath = s_socketDir + U"redis.sock";
+	const MessageBus::MessageBusOptions tcp{ .ip = U"127.0.0.1", .port = 6379 };
+	const MessageBus::MessageBusOptions unixSocket{ .ip = U"127.0.0.1", .port = 6379, .unixSocket = socketPath };
+
+	{
+		MessageBus::MessageBus probe{ unixSocket };
+		WaitForConnection(probe, 5s);
+		ASSERT_TRUE(probe.isConnected()) << probe.error();
+	}
+
+	Report("latency_tcp_median_us", MeasureEmitLatency(tcp, U"bench/socket/latency", LatencySamples), "us");
+	Report("latency_unix_socket_median_us", MeasureEmitLatency(unixSocket, U"bench/socket/latency", LatencySamples), "us");
+
+	const double tcpThroughput = MeasureEmitThroughput(tcp, U"bench/socket/throughput", TotalEvents, EmitsPerFrame);
+	const double unixThroughput = MeasureEmitThroughput(unixSocket, U"bench/socket/throughput", TotalEvents, EmitsPerFrame);
+	Report("throughput_tcp_events_per_sec", tcpThroughput, "events/s");
+	Report("throughput_unix_socket_events_per_sec", unixThroughput, "events/s");
+}
+#endif
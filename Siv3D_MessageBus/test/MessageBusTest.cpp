@@ -88,7 +88,7 @@ TEST_F(MessageBusEvents, SubscribeBeforeConnection)
 	const auto& events = bus.events();
 	EXPECT_EQ(events.size(), 1);
 	EXPECT_EQ(events[0].channel, U"t1");
-	EXPECT_EQ(events[0].value[U"k"].get<int32>(), 1);
+	EXPECT_EQ(events[0].value()[U"k"].get<int32>(), 1);
 }
 
 TEST_F(MessageBusEvents, SubscribeAfterConnection)
@@ -105,7 +105,7 @@ TEST_F(MessageBusEvents, SubscribeAfterConnection)
 	const auto& events = bus.events();
 	EXPECT_EQ(events.size(), 1);
 	EXPECT_EQ(events[0].channel, U"t1");
-	EXPECT_EQ(events[0].value[U"k"].get<int32>(), 1);
+	EXPECT_EQ(events[0].value()[U"k"].get<int32>(), 1);
 }
 
 TEST_F(MessageBusEvents, ReceiveMultipleEvents)
@@ -123,9 +123,9 @@ TEST_F(MessageBusEvents, ReceiveMultipleEvents)
 	const auto& events = bus.events();
 	ASSERT_EQ(events.size(), 2);
 	EXPECT_EQ(events[0].channel, U"t1");
-	EXPECT_EQ(events[0].value[U"k"].get<int32>(), 1);
+	EXPECT_EQ(events[0].value()[U"k"].get<int32>(), 1);
 	EXPECT_EQ(events[1].channel, U"t1");
-	EXPECT_EQ(events[1].value[U"k"].get<int32>(), 2);
+	EXPECT_EQ(events[1].value()[U"k"].get<int32>(), 2);
 }
 
 TEST_F(MessageBusEvents, DoesNotReceiveUnsubscribedEvents)
@@ -175,7 +175,7 @@ TEST_F(MessageBusEvents, AutoResubscribeAfterReconnect)
 	const auto& events = bus.events();
 	ASSERT_EQ(events.size(), 1);
 	EXPECT_EQ(events[0].channel, U"r1");
-	EXPECT_EQ(events[0].value, JSON::Invalid());
+	EXPECT_EQ(events[0].value(), JSON::Invalid());
 }
 
 // ============================================================================
@@ -196,7 +196,7 @@ TEST_F(MessageBusEvents, EmitSendsJSONPayload)
 	const auto& events = bus.events();
 	ASSERT_EQ(events.size(), 1);
 	EXPECT_EQ(events[0].channel, U"p1");
-	EXPECT_EQ(events[0].value[U"k"].get<int32>(), 123);
+	EXPECT_EQ(events[0].value()[U"k"].get<int32>(), 123);
 }
 
 TEST_F(MessageBusEvents, EmitSendsEmptyAsInvalid)
@@ -212,7 +212,7 @@ TEST_F(MessageBusEvents, EmitSendsEmptyAsInvalid)
 	const auto& events = bus.events();
 	ASSERT_EQ(events.size(), 1);
 	EXPECT_EQ(events[0].channel, U"p2");
-	EXPECT_EQ(events[0].value, JSON::Invalid());
+	EXPECT_EQ(events[0].value(), JSON::Invalid());
 }
 
 TEST_F(MessageBusEvents, EmitInvalidChannelReturnsFalse)
@@ -226,3 +226,931 @@ TEST_F(MessageBusEvents, EmitBeforeConnectionReturnsFalse)
 	MessageBus::MessageBus bus{ U"127.0.0.1", 6379, none };
 	EXPECT_FALSE(bus.emit(U"early", UR"({ "a": 1 })"_json));
 }
+
+// ============================================================================
+// MessageBus スレッドモードテスト
+// ============================================================================
+
+TEST_F(MessageBusEvents, ThreadedConnectionSuccess)
+{
+	MessageBus::MessageBus bus{ MessageBus::MessageBusOptions{ .ip = U"127.0.0.1", .port = 6379, .threaded = true } };
+
+	EXPECT_FALSE(bus.isConnected());
+	WaitForConnection(bus, 10s);
+}
+
+TEST_F(MessageBusEvents, ThreadedEmitAndReceive)
+{
+	MessageBus::MessageBus bus{ MessageBus::MessageBusOptions{ .ip = U"127.0.0.1", .port = 6379, .threaded = true } };
+	ASSERT_TRUE(bus.subscribe(U"th1"));
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	ASSERT_TRUE(bus.emit(U"th1", UR"({ "k": 7 })"_json));
+	ASSERT_TRUE(WaitForEvent(bus, 5s));
+
+	const auto& events = bus.events();
+	ASSERT_EQ(events.size(), 1);
+	EXPECT_EQ(events[0].channel, U"th1");
+	EXPECT_EQ(events[0].value()[U"k"].get<int32>(), 7);
+}
+
+TEST_F(MessageBusEvents, ThreadedReceiveExternalPublish)
+{
+	MessageBus::MessageBus bus{ MessageBus::MessageBusOptions{ .ip = U"127.0.0.1", .port = 6379, .threaded = true } };
+	ASSERT_TRUE(bus.subscribe(U"th2"));
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	Publish("th2", R"({"k":1})");
+	Publish("th2", R"({"k":2})");
+	System::Sleep(1s);
+	ASSERT_TRUE(WaitForEvent(bus, 5s));
+
+	const auto& events = bus.events();
+	ASSERT_EQ(events.size(), 2);
+	EXPECT_EQ(events[0].value()[U"k"].get<int32>(), 1);
+	EXPECT_EQ(events[1].value()[U"k"].get<int32>(), 2);
+}
+
+TEST_F(MessageBusEvents, EmitFromMultipleThreads)
+{
+	MessageBus::MessageBus bus{ MessageBus::MessageBusOptions{ .ip = U"127.0.0.1", .port = 6379, .threaded = true } };
+	ASSERT_TRUE(bus.subscribe(U"mt"));
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	constexpr int32 ThreadCount = 4;
+	constexpr int32 EmitsPerThread = 50;
+
+	std::atomic<int32> succeeded{ 0 };
+	{
+		Array<std::jthread> threads;
+		for (int32 t = 0; t < ThreadCount; ++t)
+		{
+			threads.emplace_back([&, t] {
+				for (int32 i = 0; i < EmitsPerThread; ++i)
+				{
+					JSON json;
+					json[U"t"] = t;
+					json[U"i"] = i;
+					if (bus.emit(U"mt", json))
+					{
+						++succeeded;
+					}
+				}
+			});
+		}
+	}
+	ASSERT_EQ(succeeded, ThreadCount * EmitsPerThread);
+
+	size_t received = 0;
+	WaitUntilEvents(bus, [&](const auto& events) {
+		received += events.size();
+		return received >= static_cast<size_t>(ThreadCount * EmitsPerThread);
+	}, 5s);
+	EXPECT_EQ(received, static_cast<size_t>(ThreadCount * EmitsPerThread));
+}
+
+// ============================================================================
+// MessageBus 配信モードテスト
+// ============================================================================
+
+TEST_F(MessageBusEvents, FireAndForgetCountsReplies)
+{
+	MessageBus::MessageBus bus{ MessageBus::MessageBusOptions{
+		.ip = U"127.0.0.1",
+		.port = 6379,
+		.deliveryMode = MessageBus::DeliveryMode::FireAndForget,
+	} };
+	ASSERT_TRUE(bus.subscribe(U"ff"));
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	for (int32 i = 0; i < 10; ++i)
+	{
+		ASSERT_TRUE(bus.emit(U"ff", JSON(i)));
+	}
+	Sleep(bus, 1s);
+
+	const auto stats = bus.publishStats();
+	EXPECT_EQ(stats.sent, 10);
+	EXPECT_EQ(stats.replied, 10);
+	EXPECT_EQ(stats.delivered, 10); // 自身のみが購読している
+	EXPECT_EQ(stats.errors, 0);
+}
+
+TEST_F(MessageBusEvents, EmitQueuedBeforeDisconnectIsCountedAsDropped)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379 };
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	// 送信は次の tick() で行われるため、その前に切断するとキューの分は破棄される
+	ASSERT_TRUE(bus.emit(U"dropped", JSON(1)));
+	bus.close();
+	bus.tick();
+
+	const auto stats = bus.publishStats();
+	EXPECT_EQ(stats.sent, 0);
+	EXPECT_EQ(stats.dropped, 1);
+}
+
+// ============================================================================
+// MessageBus チャンネルハンドルテスト
+// ============================================================================
+
+TEST_F(MessageBusEvents, SubscribeReturnsInternedChannelId)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379, none };
+	const auto a = bus.subscribe(U"id/a");
+	const auto b = bus.subscribe(U"id/b");
+	ASSERT_TRUE(a);
+	ASSERT_TRUE(b);
+	EXPECT_NE(a, b);
+	EXPECT_EQ(a.name(), U"id/a");
+	EXPECT_EQ(bus.subscribe(U"id/a"), a);
+	EXPECT_EQ(bus.findChannel(U"id/b"), b);
+	EXPECT_FALSE(bus.findChannel(U"id/unknown"));
+	EXPECT_FALSE(bus.subscribe(U""));
+
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	Publish("id/b", "1");
+	ASSERT_TRUE(WaitForEvent(bus, 5s));
+
+	const auto& events = bus.events();
+	ASSERT_EQ(events.size(), 1);
+	EXPECT_EQ(events[0].channel, b);
+	EXPECT_EQ(events[0].channel.name(), U"id/b");
+}
+
+TEST_F(MessageBusEvents, UnsubscribeByChannelId)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379, none };
+	const auto id = bus.subscribe(U"id/u");
+	EXPECT_TRUE(bus.unsubscribe(id));
+	EXPECT_FALSE(bus.unsubscribe(id));
+	EXPECT_FALSE(bus.unsubscribe(MessageBus::ChannelId{}));
+
+	// 購読解除後もハンドルは同じものを指す
+	EXPECT_EQ(bus.subscribe(U"id/u"), id);
+}
+
+// ============================================================================
+// MessageBus ハンドラ配送テスト
+// ============================================================================
+
+TEST_F(MessageBusEvents, HandlerReceivesOnlyItsChannel)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379, none };
+
+	Array<int32> aValues;
+	int32 bCount = 0;
+	ASSERT_TRUE(bus.subscribe(U"h/a", [&](const MessageBus::MessageBus::Event& event) {
+		EXPECT_EQ(event.channel, U"h/a");
+		aValues << event.value()[U"k"].get<int32>();
+	}));
+	ASSERT_TRUE(bus.subscribe(U"h/b", [&](const MessageBus::MessageBus::Event&) { ++bCount; }));
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	Publish("h/a", R"({"k":1})");
+	Publish("h/a", R"({"k":2})");
+	Publish("h/b", "1");
+
+	WaitUntilEvents(bus, [&](const auto&) { return aValues.size() >= 2 && bCount >= 1; }, 5s);
+	EXPECT_EQ(aValues, (Array<int32>{ 1, 2 }));
+	EXPECT_EQ(bCount, 1);
+}
+
+TEST_F(MessageBusEvents, UnsubscribeRemovesHandlers)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379, none };
+
+	int32 count = 0;
+	ASSERT_TRUE(bus.subscribe(U"h/u", [&](const MessageBus::MessageBus::Event&) { ++count; }));
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	Publish("h/u", "1");
+	WaitUntilEvents(bus, [&](const auto&) { return count >= 1; }, 5s);
+	EXPECT_EQ(count, 1);
+
+	ASSERT_TRUE(bus.unsubscribe(U"h/u"));
+	ASSERT_TRUE(bus.subscribe(U"h/u"));
+	Sleep(bus, 0.5s);
+
+	Publish("h/u", "2");
+	ASSERT_TRUE(WaitForEvent(bus, 5s));
+	EXPECT_EQ(count, 1);
+}
+
+// ============================================================================
+// MessageBus チャンネル別イベント取得テスト
+// ============================================================================
+
+TEST_F(MessageBusEvents, EventsByChannelAreGrouped)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379, none };
+	const auto a = bus.subscribe(U"g/a");
+	const auto b = bus.subscribe(U"g/b");
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	Publish("g/a", "1");
+	Publish("g/b", "2");
+	Publish("g/a", "3");
+	System::Sleep(1s);
+	ASSERT_TRUE(WaitForEvent(bus, 5s));
+
+	// 全体は受信順
+	const auto all = bus.events();
+	ASSERT_EQ(all.size(), 3);
+	EXPECT_EQ(all[0].channel, a);
+	EXPECT_EQ(all[1].channel, b);
+	EXPECT_EQ(all[2].channel, a);
+
+	// チャンネル別は連続した領域
+	const auto aEvents = bus.events(a);
+	ASSERT_EQ(aEvents.size(), 2);
+	EXPECT_EQ(aEvents[0].value().get<int32>(), 1);
+	EXPECT_EQ(aEvents[1].value().get<int32>(), 3);
+
+	const auto bEvents = bus.events(U"g/b");
+	ASSERT_EQ(bEvents.size(), 1);
+	EXPECT_EQ(bEvents[0].value().get<int32>(), 2);
+
+	EXPECT_TRUE(bus.events(U"g/unknown").empty());
+
+	// 次の tick でクリアされる
+	bus.tick();
+	EXPECT_TRUE(bus.events(a).empty());
+}
+
+TEST_F(MessageBusEvents, ReceiveLargeAndEmptyPayload)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379 };
+	ASSERT_TRUE(bus.subscribe(U"large"));
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	// 複数回の読み取りにまたがるペイロードと空のペイロード
+	JSON large;
+	large[U"data"] = String(256 * 1024, U'x');
+	ASSERT_TRUE(bus.emit(U"large", large));
+	ASSERT_TRUE(bus.emit(U"large"));
+
+	// ペイロードは次の tick() までしか有効でないためコピーして集める
+	Array<std::string> payloads;
+	ASSERT_TRUE(WaitUntilEvents(bus, [&](const auto& events)
+		{
+			for (const auto& event : events)
+			{
+				payloads.emplace_back(event.payload());
+			}
+			return payloads.size() >= 2;
+		}, 5s));
+
+	ASSERT_EQ(payloads.size(), 2);
+	EXPECT_EQ(payloads[0], large.formatUTF8Minimum());
+	EXPECT_TRUE(payloads[1].empty());
+}
+
+TEST_F(MessageBusEvents, TickWithEventLimitCarriesOverBacklog)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379 };
+	ASSERT_TRUE(bus.subscribe(U"budget"));
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	for (int32 i = 0; i < 10; ++i)
+	{
+		Publish("budget", "{\"i\":" + std::to_string(i) + "}");
+	}
+	System::Sleep(1s);
+
+	// 1回の tick() では上限までしか渡されず、残りは順番を保ったまま持ち越される
+	Array<int32> received;
+	Stopwatch sw{ StartImmediately::Yes };
+	while (received.size() < 10 && sw < 5s)
+	{
+		bus.tick(10ms, 3);
+		EXPECT_LE(bus.events().size(), 3);
+		for (const auto& event : bus.events())
+		{
+			received << event.value()[U"i"].get<int32>();
+		}
+	}
+
+	ASSERT_EQ(received.size(), 10);
+	for (int32 i = 0; i < 10; ++i)
+	{
+		EXPECT_EQ(received[i], i);
+	}
+	EXPECT_EQ(bus.backlog(), 0);
+}
+
+TEST_F(MessageBusEvents, LatestOnlyKeepsNewestMessagePerTick)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379 };
+	ASSERT_TRUE(bus.subscribe(U"cursor", MessageBus::ReceiveMode::LatestOnly));
+	ASSERT_TRUE(bus.subscribe(U"log"));
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	Publish("log", R"({"n":1})");
+	Publish("cursor", R"({"x":1})");
+	Publish("cursor", R"({"x":2})");
+	Publish("log", R"({"n":2})");
+	Publish("cursor", R"({"x":3})");
+	System::Sleep(1s);
+	ASSERT_TRUE(WaitForEvent(bus, 5s));
+
+	// cursor は最初に受信した位置に最新の値だけが残る
+	const auto& events = bus.events();
+	ASSERT_EQ(events.size(), 3);
+	EXPECT_EQ(events[0].channel, U"log");
+	EXPECT_EQ(events[1].channel, U"cursor");
+	EXPECT_EQ(events[1].value()[U"x"].get<int32>(), 3);
+	EXPECT_EQ(events[2].channel, U"log");
+	EXPECT_EQ(bus.events(U"cursor").size(), 1);
+
+	// 購読解除で通常の受信モードに戻る
+	ASSERT_TRUE(bus.unsubscribe(U"cursor"));
+	ASSERT_TRUE(bus.subscribe(U"cursor"));
+	Sleep(bus, 0.5s);
+
+	Publish("cursor", R"({"x":4})");
+	Publish("cursor", R"({"x":5})");
+	System::Sleep(1s);
+	ASSERT_TRUE(WaitForEvent(bus, 5s));
+	EXPECT_EQ(bus.events(U"cursor").size(), 2);
+}
+
+TEST_F(MessageBusEvents, LatestOnlyReplacesCarriedOverMessage)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379 };
+	ASSERT_TRUE(bus.subscribe(U"cursor", MessageBus::ReceiveMode::LatestOnly));
+	ASSERT_TRUE(bus.subscribe(U"log"));
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	// 上限1件の tick() で log だけを受け取り、cursor は持ち越される
+	Publish("log", R"({"n":1})");
+	Publish("log", R"({"n":2})");
+	Publish("cursor", R"({"x":1})");
+	System::Sleep(1s);
+	bus.tick(10ms, 1);
+	ASSERT_EQ(bus.events().size(), 1);
+	EXPECT_GE(bus.backlog(), 1);
+
+	// 持ち越し中に届いた新しい値で置き換えられ、古い値は渡されない
+	Publish("cursor", R"({"x":2})");
+	Publish("cursor", R"({"x":3})");
+	System::Sleep(1s);
+
+	Array<int32> cursors;
+	size_t logs = 1;
+	Stopwatch sw{ StartImmediately::Yes };
+	while (sw < 2s)
+	{
+		bus.tick(10ms, 1);
+		for (const auto& event : bus.events())
+		{
+			if (event.channel == U"cursor")
+			{
+				cursors << event.value()[U"x"].get<int32>();
+			}
+			else
+			{
+				++logs;
+			}
+		}
+	}
+
+	EXPECT_EQ(logs, 2);
+	ASSERT_EQ(cursors.size(), 1);
+	EXPECT_EQ(cursors[0], 3);
+}
+
+TEST_F(MessageBusEvents, CoalescingEmitSendsLatestValuePerFrame)
+{
+	MessageBus::MessageBus sender{ U"127.0.0.1", 6379 };
+	MessageBus::MessageBus receiver{ U"127.0.0.1", 6379 };
+	ASSERT_TRUE(receiver.subscribe(U"slider"));
+	sender.setEmitOptions(U"slider", MessageBus::EmitOptions{ .coalesce = true });
+	WaitForConnection(sender, 10s);
+	WaitForConnection(receiver, 10s);
+	Sleep(receiver, 0.5s);
+
+	// 同じフレームの emit は最後の値だけが送られる
+	for (int32 i = 1; i <= 10; ++i)
+	{
+		JSON value;
+		value[U"v"] = i;
+		ASSERT_TRUE(sender.emit(U"slider", value));
+	}
+	sender.tick();
+
+	ASSERT_TRUE(WaitForEvent(receiver, 5s));
+	const auto& events = receiver.events();
+	ASSERT_EQ(events.size(), 1);
+	EXPECT_EQ(events[0].value()[U"v"].get<int32>(), 10);
+	EXPECT_EQ(sender.publishStats().coalesced, 9);
+}
+
+TEST_F(MessageBusEvents, RateLimitedEmitDropsExcess)
+{
+	MessageBus::MessageBus sender{ U"127.0.0.1", 6379 };
+	sender.setEmitOptions(U"limited", MessageBus::EmitOptions{ .rateLimit = 1.0, .burst = 3.0 });
+	WaitForConnection(sender, 10s);
+
+	// バケットの容量分だけ送られ、残りは破棄される
+	for (int32 i = 0; i < 10; ++i)
+	{
+		ASSERT_TRUE(sender.emit(U"limited"));
+	}
+	sender.tick();
+
+	const auto stats = sender.publishStats();
+	EXPECT_EQ(stats.sent, 3);
+	EXPECT_EQ(stats.rateLimited, 7);
+}
+
+TEST_F(MessageBusEvents, PatternSubscriptionMatchesByLevel)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379 };
+	const auto single = bus.psubscribe(U"pt/*");
+	const auto rest = bus.psubscribe(U"pt/**");
+	ASSERT_TRUE(single);
+	ASSERT_TRUE(rest);
+	EXPECT_FALSE(bus.psubscribe(U"pt/**/x"));
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	Publish("pt/a", R"({"n":1})");
+	Publish("pt/a/b", R"({"n":2})");
+	Publish("other/a", R"({"n":3})");
+	System::Sleep(1s);
+	ASSERT_TRUE(WaitForEvent(bus, 5s));
+
+	// "*" は1階層のみ、"**" は残り全ての階層に一致する
+	const auto singleEvents = bus.events(single);
+	ASSERT_EQ(singleEvents.size(), 1);
+	EXPECT_EQ(singleEvents[0].channel, U"pt/a");
+	EXPECT_EQ(singleEvents[0].pattern, single);
+
+	const auto restEvents = bus.events(rest);
+	ASSERT_EQ(restEvents.size(), 2);
+	EXPECT_EQ(restEvents[0].channel, U"pt/a");
+	EXPECT_EQ(restEvents[1].channel, U"pt/a/b");
+	EXPECT_EQ(restEvents[1].value()[U"n"].get<int32>(), 2);
+
+	EXPECT_EQ(bus.events().size(), 3);
+
+	// パターンのみで受信したチャンネルはインターンされない（同じ tick() の中では同じハンドルになる）
+	EXPECT_EQ(singleEvents[0].channel, restEvents[0].channel);
+	EXPECT_FALSE(bus.findChannel(U"pt/a"));
+	EXPECT_FALSE(bus.findChannel(U"pt/a/b"));
+}
+
+TEST_F(MessageBusEvents, PatternUnsubscribeKeepsSharedGlob)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379 };
+	int32 handled = 0;
+	bus.psubscribe(U"pu/*", [&](const MessageBus::MessageBus::Event&) { ++handled; });
+	bus.psubscribe(U"pu/**");
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	// 同じ glob になるパターンの片方を解除しても、もう片方は受信し続ける
+	ASSERT_TRUE(bus.punsubscribe(U"pu/*"));
+	Sleep(bus, 0.5s);
+
+	Publish("pu/a", R"({})");
+	System::Sleep(1s);
+	ASSERT_TRUE(WaitForEvent(bus, 5s));
+	EXPECT_EQ(bus.events(U"pu/**").size(), 1);
+	EXPECT_EQ(handled, 0);
+}
+
+TEST_F(MessageBusEvents, StreamChannelDeliversInOrder)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379 };
+	const auto id = bus.declareStream(U"st/order", MessageBus::StreamOptions{ .maxLength = 100 });
+	ASSERT_TRUE(id);
+	Array<int32> received;
+	bus.subscribe(U"st/order", [&](const MessageBus::MessageBus::Event& e) { received << e.value()[U"n"].get<int32>(); });
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	for (int32 i = 0; i < 10; ++i)
+	{
+		bus.emit(U"st/order", JSON{ { U"n", i } });
+	}
+	Sleep(bus, 1s);
+
+	// XADD で追記されたエントリが、emit() した順に届く
+	ASSERT_EQ(received.size(), 10);
+	for (int32 i = 0; i < 10; ++i)
+	{
+		EXPECT_EQ(received[i], i);
+	}
+	EXPECT_EQ(bus.publishStats().errors, 0);
+}
+
+TEST_F(MessageBusEvents, StreamChannelResumesAfterReconnect)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379 };
+	bus.declareStream(U"st/resume");
+	int32 received = 0;
+	bus.subscribe(U"st/resume", [&](const MessageBus::MessageBus::Event&) { ++received; });
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	ExecRedisCli({ "XADD", "st/resume", "*", "payload", "{}" });
+	Sleep(bus, 0.5s);
+	ASSERT_EQ(received, 1);
+
+	// 全ての接続を切断し、再接続までの間に追加されたエントリも読み込まれる
+	ExecRedisCli({ "CLIENT", "KILL", "TYPE", "normal" });
+	ExecRedisCli({ "XADD", "st/resume", "*", "payload", "{}" });
+	ExecRedisCli({ "XADD", "st/resume", "*", "payload", "{}" });
+
+	Stopwatch sw{ StartImmediately::Yes };
+	while (sw < 15s && received < 3)
+	{
+		bus.tick();
+		System::Sleep(TICK_INTERVAL);
+	}
+	EXPECT_EQ(received, 3);
+}
+
+TEST_F(MessageBusEvents, MessagePackPayloadRoundTrip)
+{
+	MessageBus::MessageBus sender{ MessageBus::MessageBusOptions{ .ip = U"127.0.0.1", .port = 6379, .payloadFormat = MessageBus::PayloadFormat::MessagePack } };
+	MessageBus::MessageBus receiver{ U"127.0.0.1", 6379 };
+	receiver.subscribe(U"mp/telemetry");
+	WaitForConnection(sender, 10s);
+	WaitForConnection(receiver, 10s);
+	Sleep(receiver, 0.5s);
+
+	JSON payload;
+	payload[U"id"] = 300;
+	payload[U"offset"] = -70000;
+	payload[U"x"] = 1.5;
+	payload[U"y"] = 0.1;
+	payload[U"name"] = U"センサー";
+	payload[U"active"] = true;
+	payload[U"samples"] = JSON(Array<JSON>{ 1, 2, 3 });
+	payload[U"none"] = nullptr;
+	ASSERT_TRUE(sender.emit(U"mp/telemetry", payload));
+
+	// JSON の送信元と混在しても、識別バイトで形式を判別する
+	Publish("mp/telemetry", R"({"text":true})");
+
+	// ペイロードは次の tick() までしか有効でないため、受信したフレームで取り出す
+	Optional<JSON> binary;
+	Optional<JSON> text;
+	ASSERT_TRUE(WaitUntilEvents(receiver, [&](const auto& events)
+		{
+			for (const auto& e : events)
+			{
+				if (e.isBinary())
+				{
+					EXPECT_EQ(static_cast<unsigned char>(e.payload().front()), MessageBus::BINARY_PAYLOAD_MARKER);
+					binary = e.value();
+				}
+				else
+				{
+					text = e.value();
+				}
+			}
+			return binary && text;
+		}, 5s));
+
+	EXPECT_EQ(*binary, payload);
+	EXPECT_TRUE((*text)[U"text"].get<bool>());
+}
+
+namespace
+{
+	struct TypedSample
+	{
+		int32 id = 0;
+		double x = 0.0;
+		String label;
+		Array<int32> values;
+		Optional<int32> missing;
+
+		MESSAGEBUS_FIELDS(id, x, label, values, missing)
+	};
+}
+
+TEST_F(MessageBusEvents, TypedEmitAndSubscribe)
+{
+	for (const auto format : { MessageBus::PayloadFormat::JSON, MessageBus::PayloadFormat::MessagePack })
+	{
+		MessageBus::MessageBus bus{ MessageBus::MessageBusOptions{ .ip = U"127.0.0.1", .port = 6379, .payloadFormat = format } };
+		Array<TypedSample> received;
+		bus.subscribe<TypedSample>(U"typed/sample", [&](const TypedSample& sample) { received << sample; });
+		WaitForConnection(bus, 10s);
+		Sleep(bus, 0.5s);
+
+		ASSERT_TRUE(bus.emit(U"typed/sample", TypedSample{ .id = 7, .x = 0.25, .label = U"ラベル", .values = { 1, -2, 300 } }));
+
+		// 型が合わないペイロードはハンドラに渡さない
+		Publish("typed/sample", R"({"id":"not a number"})");
+
+		ASSERT_TRUE(WaitUntilEvents(bus, [&](const auto&) { return not received.isEmpty(); }, 5s));
+		Sleep(bus, 0.5s);
+
+		ASSERT_EQ(received.size(), 1);
+		EXPECT_EQ(received[0].id, 7);
+		EXPECT_EQ(received[0].x, 0.25);
+		EXPECT_EQ(received[0].label, U"ラベル");
+		EXPECT_EQ(received[0].values, (Array<int32>{ 1, -2, 300 }));
+		EXPECT_FALSE(received[0].missing);
+	}
+}
+
+TEST_F(MessageBusEvents, ForwardRawPayloadBetweenBuses)
+{
+	MessageBus::MessageBus source{ MessageBus::MessageBusOptions{ .ip = U"127.0.0.1", .port = 6379, .payloadFormat = MessageBus::PayloadFormat::MessagePack } };
+	MessageBus::MessageBus relay{ U"127.0.0.1", 6379 };
+	MessageBus::MessageBus sink{ U"127.0.0.1", 6379 };
+	relay.subscribe(U"raw/in");
+	sink.subscribe(U"raw/out");
+	WaitForConnection(source, 10s);
+	WaitForConnection(relay, 10s);
+	WaitForConnection(sink, 10s);
+	Sleep(relay, 0.5s);
+
+	JSON payload;
+	payload[U"n"] = 42;
+	ASSERT_TRUE(source.emit(U"raw/in", payload));
+	source.tick();
+
+	// 受信したバイト列を変換せずに別のチャンネルへ転送する
+	std::string forwarded;
+	ASSERT_TRUE(WaitUntilEvents(relay, [&](const auto& events)
+		{
+			for (const auto& e : events)
+			{
+				forwarded.assign(e.payload());
+				EXPECT_TRUE(relay.emitRaw("raw/out", e.rawPayload()));
+			}
+			return not forwarded.empty();
+		}, 5s));
+	relay.tick();
+
+	std::string received;
+	Optional<JSON> value;
+	ASSERT_TRUE(WaitUntilEvents(sink, [&](const auto& events)
+		{
+			for (const auto& e : events)
+			{
+				received.assign(e.payload());
+				value = e.value();
+			}
+			return value.has_value();
+		}, 5s));
+
+	EXPECT_EQ(received, forwarded);
+	EXPECT_EQ(*value, payload);
+}
+
+TEST_F(MessageBusEvents, SharedHubFansOutToFrontEnds)
+{
+	MessageBus::MessageBusHub hub{ U"127.0.0.1", 6379 };
+	MessageBus::MessageBus a{ hub };
+	MessageBus::MessageBus b{ hub };
+	EXPECT_EQ(hub.frontEndCount(), 2);
+
+	const auto aId = a.subscribe(U"hub/x");
+	const auto bId = b.subscribe(U"hub/x");
+	b.psubscribe(U"hub/*");
+	WaitForConnection(a, 10s);
+	WaitForConnection(b, 10s);
+	Sleep(a, 0.5s);
+	Sleep(b, 0.5s);
+
+	// 1回の PUBLISH が両方の MessageBus に届く（b はチャンネルとパターンの両方で受け取る）
+	Publish("hub/x", R"({"n":1})");
+	size_t aCount = 0;
+	size_t bCount = 0;
+	ASSERT_TRUE(WaitUntilEvents(a, [&](const auto&) { aCount += a.events(aId).size(); return aCount >= 1; }, 5s));
+	ASSERT_TRUE(WaitUntilEvents(b, [&](const auto& events) { bCount += events.size(); return bCount >= 2; }, 5s));
+	EXPECT_EQ(aCount, 1);
+	EXPECT_EQ(bCount, 2);
+
+	// 片方が購読を解除しても、もう片方が購読している間はハブの購読が残る
+	ASSERT_TRUE(a.unsubscribe(aId));
+	a.tick();
+	Sleep(b, 0.5s);
+	Publish("hub/x", R"({"n":2})");
+	size_t bChannelCount = 0;
+	ASSERT_TRUE(WaitUntilEvents(b, [&](const auto&) { bChannelCount += b.events(bId).size(); return bChannelCount >= 1; }, 5s));
+	EXPECT_FALSE(WaitForEvent(a, 1s));
+
+	// フロントエンドからの emit() はハブの接続で送られる
+	JSON payload;
+	payload[U"n"] = 3;
+	ASSERT_TRUE(a.emit(U"hub/x", payload));
+	bChannelCount = 0;
+	ASSERT_TRUE(WaitUntilEvents(b, [&](const auto&) { bChannelCount += b.events(bId).size(); return bChannelCount >= 1; }, 5s));
+}
+
+TEST_F(MessageBusEvents, SharedHubCoalescesOncePerFrame)
+{
+	constexpr int32 Frames = 20;
+
+	MessageBus::MessageBusHub hub{ U"127.0.0.1", 6379 };
+	MessageBus::MessageBus a{ hub };
+	MessageBus::MessageBus b{ hub };
+	a.setEmitOptions(U"hub/slider", MessageBus::EmitOptions{ .coalesce = true });
+	WaitForConnection(a, 10s);
+	WaitForConnection(b, 10s);
+
+	// 両方の MessageBus が同じフレームで emit しても、送られるのはフレームごとに最新の1件
+	for (int32 frame = 0; frame < Frames; ++frame)
+	{
+		ASSERT_TRUE(a.emit(U"hub/slider", JSON(frame * 2)));
+		a.tick();
+		ASSERT_TRUE(b.emit(U"hub/slider", JSON(frame * 2 + 1)));
+		b.tick();
+		System::Sleep(TICK_INTERVAL);
+	}
+	Sleep(a, 0.5s);
+
+	const auto stats = a.publishStats();
+	EXPECT_LE(stats.sent, Frames + 1);
+	EXPECT_GE(stats.coalesced, Frames - 1);
+	EXPECT_EQ(stats.sent + stats.coalesced, Frames * 2);
+}
+
+TEST_F(MessageBusEvents, LocalDeliverySuppressesRedisEcho)
+{
+	const MessageBus::MessageBusOptions options{ .ip = U"127.0.0.1", .port = 6379, .localDelivery = true };
+	MessageBus::MessageBus bus{ options };
+	MessageBus::MessageBus remote{ options };
+	const auto channel = bus.subscribe(U"local/a");
+	const auto pattern = bus.psubscribe(U"local/*");
+	const auto remoteChannel = remote.subscribe(U"local/a");
+	WaitForConnection(bus, 10s);
+	WaitForConnection(remote, 10s);
+	Sleep(bus, 0.5s);
+
+	JSON payload;
+	payload[U"n"] = 1;
+	ASSERT_TRUE(bus.emit(U"local/a", payload));
+
+	// 次の tick() でチャンネルとパターンの両方に1件ずつ届き、Redis から戻ってきたものは破棄される
+	bus.tick();
+	EXPECT_EQ(bus.events(channel).size(), 1);
+	EXPECT_EQ(bus.events(pattern).size(), 1);
+	EXPECT_FALSE(WaitForEvent(bus, 1s));
+
+	// localDelivery を有効にした他の MessageBus には、送信元タグを取り除いたペイロードが届く
+	std::string received;
+	Optional<JSON> value;
+	ASSERT_TRUE(WaitUntilEvents(remote, [&](const auto&)
+		{
+			for (const auto& e : remote.events(remoteChannel))
+			{
+				received.assign(e.payload());
+				value = e.value();
+			}
+			return value.has_value();
+		}, 5s));
+	EXPECT_EQ(received.front(), '{');
+	EXPECT_EQ(*value, payload);
+}
+
+TEST_F(MessageBusEvents, OriginTagIsKeptWithoutLocalDelivery)
+{
+	MessageBus::MessageBus bus{ U"127.0.0.1", 6379 };
+	const auto channel = bus.subscribe(U"local/raw");
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 0.5s);
+
+	// localDelivery が無効な場合は、送信元タグと同じ形のペイロードもそのまま受け取る
+	std::string raw(12, '\x01');
+	raw[0] = static_cast<char>(MessageBus::ORIGIN_TAG_MARKER);
+	ASSERT_TRUE(bus.emitRaw(channel, std::as_bytes(std::span{ raw })));
+
+	std::string received;
+	ASSERT_TRUE(WaitUntilEvents(bus, [&](const auto&)
+		{
+			for (const auto& e : bus.events(channel))
+			{
+				received.assign(e.payload());
+			}
+			return not received.empty();
+		}, 5s));
+	EXPECT_EQ(received, raw);
+}
+
+TEST_F(MessageBusEvents, SharedMemoryTransportDeliversBetweenBuses)
+{
+	const MessageBus::MessageBusOptions options{
+		.transport = MessageBus::Transport::SharedMemory,
+		.sharedMemoryName = U"MessageBusTest_SharedMemory",
+	};
+	MessageBus::MessageBus sender{ options };
+	MessageBus::MessageBus receiver{ options };
+	ASSERT_TRUE(sender.isConnected()) << sender.error();
+	ASSERT_TRUE(receiver.isConnected()) << receiver.error();
+
+	const auto channel = receiver.subscribe(U"shm/a");
+	const auto pattern = receiver.psubscribe(U"shm/*");
+
+	JSON payload;
+	payload[U"n"] = 1;
+	ASSERT_TRUE(sender.emit(U"shm/a", payload));
+	ASSERT_TRUE(sender.emit(U"shm/b", payload));
+	ASSERT_TRUE(sender.emit(U"other", payload));
+	sender.tick();
+
+	receiver.tick();
+	ASSERT_EQ(receiver.events(channel).size(), 1);
+	EXPECT_EQ(receiver.events(channel)[0].value(), payload);
+	EXPECT_EQ(receiver.events(pattern).size(), 2);
+	EXPECT_EQ(receiver.events().size(), 3);
+
+	// スロットに収まらないペイロードは送信されない
+	JSON large;
+	large[U"s"] = String(2048, U'x');
+	ASSERT_TRUE(sender.emit(U"shm/a", large));
+	sender.tick();
+	receiver.tick();
+	EXPECT_EQ(receiver.events().size(), 0);
+	EXPECT_EQ(sender.publishStats().errors, 1);
+}
+
+// ============================================================================
+// MessageBus クラスタテスト
+// ============================================================================
+
+class MessageBusCluster : public RedisDocker
+{
+protected:
+	static void SetUpTestSuite()
+	{
+		RedisDocker::SetUpTestSuite();
+		StartClusterContainer();
+	}
+
+	static void TearDownTestSuite()
+	{
+		RedisDocker::TearDownTestSuite();
+	}
+};
+
+TEST_F(MessageBusCluster, ShardedSubscribeAcrossSlots)
+{
+	MessageBus::MessageBus bus{ MessageBus::MessageBusOptions{ .ip = U"127.0.0.1", .port = 7000, .cluster = true } };
+
+	// 異なるスロット（シャード）に割り当てられるチャンネル
+	const Array<String> channels{ U"cl/a", U"cl/b", U"cl/c", U"cl/d" };
+	HashTable<String, int32> received;
+	for (const auto& channel : channels)
+	{
+		ASSERT_TRUE(bus.subscribe(channel, [&](const MessageBus::MessageBus::Event& e) { ++received[e.channel]; }));
+	}
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 1s);
+
+	for (const auto& channel : channels)
+	{
+		SPublish(channel.narrow(), R"({"n":1})");
+	}
+	Sleep(bus, 2s);
+
+	for (const auto& channel : channels)
+	{
+		EXPECT_EQ(received[channel], 1) << channel;
+	}
+}
+
+TEST_F(MessageBusCluster, EmitRoutesToSlotOwner)
+{
+	MessageBus::MessageBus bus{ MessageBus::MessageBusOptions{ .ip = U"127.0.0.1", .port = 7000, .cluster = true } };
+	int32 started = 0;
+	int32 ended = 0;
+	bus.subscribe(U"{room}/start", [&](const MessageBus::MessageBus::Event&) { ++started; });
+	bus.subscribe(U"{room}/end", [&](const MessageBus::MessageBus::Event&) { ++ended; });
+	WaitForConnection(bus, 10s);
+	Sleep(bus, 1s);
+
+	// 同じハッシュタグのチャンネルは同じシャードで送受信される
+	bus.emit(U"{room}/start");
+	bus.emit(U"{room}/end");
+	Sleep(bus, 2s);
+
+	EXPECT_EQ(started, 1);
+	EXPECT_EQ(ended, 1);
+	EXPECT_EQ(bus.publishStats().errors, 0);
+}
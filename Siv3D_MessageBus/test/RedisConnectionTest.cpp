@@ -170,6 +170,15 @@ TEST_F(RedisConnectionBasic, InvalidHost)
 	EXPECT_TRUE(conn.isReconnecting());
 }
 
+TEST_F(RedisConnectionBasic, ConnectByHostName)
+{
+	// 名前解決はバックグラウンドで行うため、コンストラクタは Connecting のまま戻る
+	MessageBus::RedisConnection conn{ { U"localhost", 6379, none } };
+
+	EXPECT_EQ(conn.state(), MessageBus::RedisConnectionState::Connecting);
+	EXPECT_TRUE(WaitForConnection(conn, 10s));
+}
+
 TEST_F(RedisConnectionBasic, InvalidPort)
 {
 	MessageBus::RedisConnection conn{ { U"127.0.0.1", 6380, none } };
@@ -179,6 +188,17 @@ TEST_F(RedisConnectionBasic, InvalidPort)
 	EXPECT_TRUE(conn.isReconnecting());
 }
 
+#if defined(_WIN32)
+TEST_F(RedisConnectionBasic, UnixSocketIsRejectedOnWindows)
+{
+	MessageBus::RedisConnection conn{ { .ip = U"127.0.0.1", .port = 6379, .unixSocket = U"redis.sock" } };
+
+	EXPECT_EQ(conn.state(), MessageBus::RedisConnectionState::Failed);
+	EXPECT_FALSE(conn.isReconnecting());
+	EXPECT_TRUE(conn.error().includes(U"not supported on Windows"));
+}
+#endif
+
 TEST_F(RedisConnectionBasic, NoPasswordNeeded)
 {
 	MessageBus::RedisConnection conn{ { U"127.0.0.1", 6379, U"unnecessary_password" } };
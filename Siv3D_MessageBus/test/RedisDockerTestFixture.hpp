@@ -143,6 +143,86 @@ protected:
 		}
 	}
 
+	// TCP（6379）に加えて Unix ドメインソケットでも待ち受ける Redis を起動
+	// ソケットはホストの socketDir にマウントしたディレクトリ内の redis.sock に作られる
+	static void StartUnixSocketContainer(const std::string& socketDir, const char* image = REDIS_IMAGE)
+	{
+		try
+		{
+			Console << U"Starting Redis Docker container with unix socket...";
+			bp::child c(
+				s_dockerPath, "run",
+				"--rm",
+				"-d",
+				"--name", REDIS_CONTAINER_NAME,
+				"-p", "6379:6379",
+				"-v", socketDir + ":/run/redis",
+				"--health-cmd", "redis-cli -s /run/redis/redis.sock --raw incr ping",
+				"--health-interval", "1s",
+				"--health-timeout", "3s",
+				"--health-retries", "5",
+				image,
+				"redis-server", "--unixsocket", "/run/redis/redis.sock", "--unixsocketperm", "777"
+			);
+			c.wait();
+			if (c.exit_code() != 0)
+			{
+				FAIL() << "Failed to start Redis container with unix socket";
+			}
+
+			WaitForContainerHealthy(30s);
+
+			s_password.clear();
+			s_started = true;
+		}
+		catch (const std::exception& e)
+		{
+			FAIL() << "Exception starting Redis container: " << e.what();
+		}
+	}
+
+	// 3ノード（ポート 7000-7002）の Redis Cluster を1つのコンテナ内に起動
+	static void StartClusterContainer(const char* image = REDIS_IMAGE)
+	{
+		try
+		{
+			Console << U"Starting Redis Cluster Docker container...";
+			bp::child c(
+				s_dockerPath, "run",
+				"--rm",
+				"-d",
+				"--name", REDIS_CONTAINER_NAME,
+				"-p", "7000-7002:7000-7002",
+				"--health-cmd", "redis-cli -p 7000 cluster info | grep -q cluster_state:ok",
+				"--health-interval", "1s",
+				"--health-timeout", "3s",
+				"--health-retries", "10",
+				image,
+				"sh", "-c",
+				"for p in 7000 7001 7002; do "
+				"redis-server --port $p --cluster-enabled yes --cluster-config-file nodes-$p.conf --cluster-announce-ip 127.0.0.1 --daemonize yes; "
+				"done; "
+				"sleep 1; "
+				"redis-cli --cluster create 127.0.0.1:7000 127.0.0.1:7001 127.0.0.1:7002 --cluster-yes; "
+				"tail -f /dev/null"
+			);
+			c.wait();
+			if (c.exit_code() != 0)
+			{
+				FAIL() << "Failed to start Redis Cluster container";
+			}
+
+			WaitForContainerHealthy(60s);
+
+			s_password.clear();
+			s_started = true;
+		}
+		catch (const std::exception& e)
+		{
+			FAIL() << "Exception starting Redis Cluster container: " << e.what();
+		}
+	}
+
 	static void StopContainer()
 	{
 		if (!s_started) return;
@@ -215,4 +295,17 @@ protected:
 		c.wait();
 		ASSERT_EQ(c.exit_code(), 0);
 	}
+
+	// spublish ヘルパー（docker exec で redis-cli -c SPUBLISH、スロットを持つノードへ転送される）
+	static void SPublish(std::string_view channel, std::string payload)
+	{
+		bp::child c(
+			s_dockerPath,
+			"exec", REDIS_CONTAINER_NAME,
+			"redis-cli", "-c", "-p", "7000",
+			"SPUBLISH", channel.data(), payload.data()
+		);
+		c.wait();
+		ASSERT_EQ(c.exit_code(), 0);
+	}
 };
@@ -0,0 +1,115 @@
+﻿#include <gtest/gtest.h>
+#include "../src/SharedMemoryRing.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+// ============================================================================
+// 共有メモリのリングバッファ（書き込みが途中で止まったスロットの扱い）
+// ============================================================================
+
+namespace MessageBus
+{
+	class SharedMemoryRingTest : public ::testing::Test
+	{
+	protected:
+		static constexpr std::size_t SlotCount = 2;
+		static constexpr std::size_t SlotSize = 64;
+
+		// 実在しないプロセス ID（Windows のプロセス ID は 4 の倍数で、この値までは割り当てられない）
+		static constexpr std::uint32_t ExitedProcessId = 0x7FFFFFFC;
+
+		static std::string SegmentName(const char* test)
+		{
+			return std::string{ "Siv3D_MessageBus_Test_" } + test + "_" + std::to_string(SharedMemoryRing::CurrentProcessId());
+		}
+
+		static std::uint32_t CurrentProcessId()
+		{
+			return SharedMemoryRing::CurrentProcessId();
+		}
+
+		// processId のプロセスがチケットを取ってチャンネル名だけ書いたところで止まった状態にする
+		static std::uint64_t StallWriter(SharedMemoryRing& ring, std::uint32_t processId, std::string_view channel)
+		{
+			const std::uint64_t ticket = std::atomic_ref<std::uint64_t>{ ring.m_header->writeIndex }.fetch_add(1);
+			SharedMemoryRing::SlotHeader* slot = ring.slotAt(ticket);
+			std::atomic_ref<std::uint64_t>{ slot->sequence }.store(ticket * 2 + 1);
+			slot->ownerProcess = processId;
+			std::atomic_ref<std::uint64_t>{ slot->ownerSequence }.store(ticket * 2 + 1);
+
+			slot->channelSize = static_cast<std::uint32_t>(channel.size());
+			slot->payloadSize = 1;
+			std::memcpy(slot + 1, channel.data(), channel.size());
+			return ticket;
+		}
+
+		static std::uint64_t Sequence(SharedMemoryRing& ring, std::uint64_t ticket)
+		{
+			return std::atomic_ref<std::uint64_t>{ ring.slotAt(ticket)->sequence }.load();
+		}
+	};
+
+	TEST_F(SharedMemoryRingTest, WriterDoesNotTakeOverSlotOfRunningProcess)
+	{
+		const std::string name = SegmentName("Running");
+		SharedMemoryRing ring{ name, SlotCount, SlotSize };
+		ASSERT_TRUE(ring.isOpen()) << ring.error();
+
+		// 止まっているだけの書き込みと内容が混ざらないよう、1周後の書き込みは破棄される
+		const std::uint64_t stalled = StallWriter(ring, CurrentProcessId(), "stalled");
+		EXPECT_EQ(ring.write("a", "1"), SharedMemoryRing::WriteResult::Written);
+		EXPECT_EQ(ring.write("b", "2"), SharedMemoryRing::WriteResult::Dropped);
+		EXPECT_EQ(Sequence(ring, stalled), stalled * 2 + 1);
+	}
+
+	TEST_F(SharedMemoryRingTest, WriterTakesOverSlotOfExitedProcess)
+	{
+		const std::string name = SegmentName("Exited");
+		SharedMemoryRing reader{ name, SlotCount, SlotSize };
+		SharedMemoryRing writer{ name, SlotCount, SlotSize };
+		ASSERT_TRUE(reader.isOpen()) << reader.error();
+		ASSERT_TRUE(writer.isOpen()) << writer.error();
+
+		StallWriter(writer, ExitedProcessId, "stalled");
+		EXPECT_EQ(writer.write("a", "1"), SharedMemoryRing::WriteResult::Written);
+		EXPECT_EQ(writer.write("b", "2"), SharedMemoryRing::WriteResult::Written);
+
+		std::string_view channel;
+		std::string_view payload;
+		ASSERT_TRUE(reader.next(channel, payload));
+		EXPECT_EQ(channel, "a");
+		EXPECT_EQ(payload, "1");
+		ASSERT_TRUE(reader.next(channel, payload));
+		EXPECT_EQ(channel, "b");
+		EXPECT_EQ(payload, "2");
+		EXPECT_EQ(reader.dropped(), 1);
+	}
+
+	TEST_F(SharedMemoryRingTest, ReaderSkipsStalledSlotAfterTimeout)
+	{
+		const std::string name = SegmentName("Reader");
+		SharedMemoryRing reader{ name, SlotCount, SlotSize };
+		SharedMemoryRing writer{ name, SlotCount, SlotSize };
+		ASSERT_TRUE(reader.isOpen()) << reader.error();
+		ASSERT_TRUE(writer.isOpen()) << writer.error();
+
+		StallWriter(writer, CurrentProcessId(), "stalled");
+		EXPECT_EQ(writer.write("a", "1"), SharedMemoryRing::WriteResult::Written);
+
+		// 書き込み中のスロットで待つ（途中まで書かれた内容は返さない）
+		std::string_view channel;
+		std::string_view payload;
+		EXPECT_FALSE(reader.next(channel, payload));
+		EXPECT_FALSE(reader.next(channel, payload));
+
+		// 一定時間終わらなければ読み飛ばして先に進む
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 200 });
+		ASSERT_TRUE(reader.next(channel, payload));
+		EXPECT_EQ(channel, "a");
+		EXPECT_EQ(payload, "1");
+		EXPECT_EQ(reader.dropped(), 1);
+	}
+}
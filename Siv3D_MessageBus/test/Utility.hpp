@@ -118,3 +118,17 @@ static void Sleep(MessageBus::MessageBus& bus, Duration time)
 		System::Sleep(TICK_INTERVAL);
 	}
 }
+
+// tick ごとに受信イベントを predicate に渡し、true を返すまで待機
+template <class Pred>
+static bool WaitUntilEvents(MessageBus::MessageBus& bus, Pred&& predicate, Duration timeout = 5s)
+{
+	Stopwatch sw{ StartImmediately::Yes };
+	while (sw < timeout)
+	{
+		bus.tick();
+		if (predicate(bus.events())) return true;
+		System::Sleep(TICK_INTERVAL);
+	}
+	return false;
+}